@@ -62,7 +62,8 @@ typedef enum _ENetSocketOption
    ENET_SOCKOPT_RCVTIMEO  = 6,
    ENET_SOCKOPT_SNDTIMEO  = 7,
    ENET_SOCKOPT_ERROR     = 8,
-   ENET_SOCKOPT_NODELAY   = 9
+   ENET_SOCKOPT_NODELAY   = 9,
+   ENET_SOCKOPT_REUSEPORT = 10
 } ENetSocketOption;
 
 typedef enum _ENetSocketShutdown
@@ -215,6 +216,9 @@ enum
    ENET_HOST_DEFAULT_MTU                  = 1400,
    ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
    ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+   ENET_HOST_RECEIVE_BATCH_COUNT          = 32,
+   ENET_HOST_SEND_BATCH_COUNT             = 32,
+   ENET_HOST_SEND_BATCH_DATA_SIZE         = ENET_PROTOCOL_MAXIMUM_MTU + sizeof (enet_uint32), /* a datagram including an optional checksum */
 
    ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
    ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
@@ -383,6 +387,17 @@ typedef struct _ENetHost
    ENetAddress          receivedAddress;
    enet_uint8 *         receivedData;
    size_t               receivedDataLength;
+   enet_uint8 *         receiveBatchData;            /**< datagrams read by the last batched receive, ENET_PROTOCOL_MAXIMUM_MTU bytes each */
+   ENetAddress *        receiveBatchAddresses;
+   size_t *             receiveBatchLengths;
+   size_t               receiveBatchLimit;           /**< number of datagrams read by one batched receive, see enet_socket_receive_batch_limit() */
+   size_t               receiveBatchCount;           /**< number of datagrams in the receive batch */
+   size_t               receiveBatchIndex;           /**< next datagram in the receive batch to be handled */
+   enet_uint8 *         sendBatchData;               /**< outgoing datagrams waiting for a batched send, ENET_HOST_SEND_BATCH_DATA_SIZE bytes each */
+   ENetAddress *        sendBatchAddresses;
+   ENetBuffer *         sendBatchBuffers;
+   size_t               sendBatchLimit;              /**< number of datagrams sent by one batched send, see enet_socket_send_batch_limit() */
+   size_t               sendBatchCount;              /**< number of datagrams in the send batch */
    enet_uint32          totalSentData;               /**< total data sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalSentPackets;            /**< total UDP packets sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedData;           /**< total data received, user should reset to 0 as needed to prevent overflow */
@@ -395,6 +410,15 @@ typedef struct _ENetHost
    size_t               maximumWaitingData;          /**< the maximum aggregate amount of buffer space a peer may use waiting for packets to be delivered */
 } ENetHost;
 
+/** Hosts sharing one port, see enet_host_group_create().
+ */
+typedef struct _ENetHostGroup
+{
+   ENetHost **          hosts;                       /**< the hosts, one for each shard */
+   size_t               hostCount;                   /**< number of hosts in the group */
+   ENetAddress          address;                     /**< Internet address shared by the hosts */
+} ENetHostGroup;
+
 /**
  * An ENet event type, as specified in @ref ENetEvent.
  */
@@ -496,7 +520,11 @@ ENET_API int        enet_socket_listen (ENetSocket, int);
 ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
+ENET_API int        enet_socket_send_batch (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
+ENET_API size_t     enet_socket_send_batch_limit (void);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_receive_batch (ENetSocket, ENetAddress *, ENetBuffer *, size_t *, size_t);
+ENET_API size_t     enet_socket_receive_batch_limit (void);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API int        enet_socket_get_option (ENetSocket, ENetSocketOption, int *);
@@ -506,6 +534,26 @@ ENET_API int        enet_socketset_select (ENetSocket, ENetSocketSet *, ENetSock
 
 /** @} */
 
+/** @defgroup waiter ENet host waiter functions
+
+    Waits on the sockets of many hosts from one thread. On Linux it is backed by
+    level-triggered epoll and an eventfd, elsewhere by select. A host is returned
+    by enet_host_waiter_wait() as long as its socket has data or datagrams of its
+    last batched receive are not handled yet, so a host serviced only in part is
+    returned again by the next wait.
+    @{
+*/
+typedef struct _ENetHostWaiter ENetHostWaiter;
+
+ENET_API ENetHostWaiter * enet_host_waiter_create (void);
+ENET_API void             enet_host_waiter_destroy (ENetHostWaiter *);
+ENET_API int              enet_host_waiter_add (ENetHostWaiter *, ENetHost *);
+ENET_API int              enet_host_waiter_remove (ENetHostWaiter *, ENetHost *);
+ENET_API int              enet_host_waiter_wake (ENetHostWaiter *);
+ENET_API int              enet_host_waiter_wait (ENetHostWaiter *, ENetHost **, size_t, enet_uint32);
+
+/** @} */
+
 /** @defgroup Address ENet address functions
     @{
 */
@@ -547,6 +595,9 @@ ENET_API int          enet_packet_resize  (ENetPacket *, size_t);
 ENET_API enet_uint32  enet_crc32 (const ENetBuffer *, size_t);
                 
 ENET_API ENetHost * enet_host_create (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+ENET_API ENetHost * enet_host_create_shared (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+ENET_API ENetHostGroup * enet_host_group_create (const ENetAddress *, size_t, size_t, size_t, enet_uint32, enet_uint32);
+ENET_API void       enet_host_group_destroy (ENetHostGroup *);
 ENET_API void       enet_host_destroy (ENetHost *);
 ENET_API ENetPeer * enet_host_connect (ENetHost *, const ENetAddress *, size_t, enet_uint32);
 ENET_API int        enet_host_check_events (ENetHost *, ENetEvent *);
@@ -10,6 +10,8 @@
     @{
 */
 
+static ENetHost * enet_host_create_internal (const ENetAddress *, int, size_t, size_t, enet_uint32, enet_uint32);
+
 /** Creates a host for communicating to peers.  
 
     @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
@@ -27,6 +29,51 @@
 */
 ENetHost *
 enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    return enet_host_create_internal (address, 0, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth);
+}
+
+/** Creates a host which shares its port with other hosts created by this function.
+
+    The socket is bound with SO_REUSEPORT, the system spreads the incoming datagrams
+    between the hosts by a hash of the sender address. Each host may then be serviced
+    by its own thread. The parameters are the same as for enet_host_create().
+
+    @returns the host on success and NULL on failure, e.g. if SO_REUSEPORT is not supported
+*/
+ENetHost *
+enet_host_create_shared (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    return enet_host_create_internal (address, 1, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth);
+}
+
+/* Frees the buffers of the batched receive and send, and the host. */
+static void
+enet_host_free (ENetHost * host)
+{
+    if (host -> receiveBatchData != NULL)
+      enet_free (host -> receiveBatchData);
+
+    if (host -> receiveBatchAddresses != NULL)
+      enet_free (host -> receiveBatchAddresses);
+
+    if (host -> receiveBatchLengths != NULL)
+      enet_free (host -> receiveBatchLengths);
+
+    if (host -> sendBatchData != NULL)
+      enet_free (host -> sendBatchData);
+
+    if (host -> sendBatchAddresses != NULL)
+      enet_free (host -> sendBatchAddresses);
+
+    if (host -> sendBatchBuffers != NULL)
+      enet_free (host -> sendBatchBuffers);
+
+    enet_free (host);
+}
+
+static ENetHost *
+enet_host_create_internal (const ENetAddress * address, int reusePort, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
 {
     ENetHost * host;
     ENetPeer * currentPeer;
@@ -39,23 +86,46 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
       return NULL;
     memset (host, 0, sizeof (ENetHost));
 
+    /* Only room for one datagram where the socket can not receive or send a batch. */
+    host -> receiveBatchLimit = enet_socket_receive_batch_limit ();
+    host -> receiveBatchData = (enet_uint8 *) enet_malloc (host -> receiveBatchLimit * ENET_PROTOCOL_MAXIMUM_MTU);
+    host -> receiveBatchAddresses = (ENetAddress *) enet_malloc (host -> receiveBatchLimit * sizeof (ENetAddress));
+    host -> receiveBatchLengths = (size_t *) enet_malloc (host -> receiveBatchLimit * sizeof (size_t));
+    host -> sendBatchLimit = enet_socket_send_batch_limit ();
+    host -> sendBatchData = (enet_uint8 *) enet_malloc (host -> sendBatchLimit * ENET_HOST_SEND_BATCH_DATA_SIZE);
+    host -> sendBatchAddresses = (ENetAddress *) enet_malloc (host -> sendBatchLimit * sizeof (ENetAddress));
+    host -> sendBatchBuffers = (ENetBuffer *) enet_malloc (host -> sendBatchLimit * sizeof (ENetBuffer));
+    if (host -> receiveBatchData == NULL ||
+        host -> receiveBatchAddresses == NULL ||
+        host -> receiveBatchLengths == NULL ||
+        host -> sendBatchData == NULL ||
+        host -> sendBatchAddresses == NULL ||
+        host -> sendBatchBuffers == NULL)
+    {
+       enet_host_free (host);
+
+       return NULL;
+    }
+
     host -> peers = (ENetPeer *) enet_malloc (peerCount * sizeof (ENetPeer));
     if (host -> peers == NULL)
     {
-       enet_free (host);
+       enet_host_free (host);
 
        return NULL;
     }
     memset (host -> peers, 0, peerCount * sizeof (ENetPeer));
 
     host -> socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
-    if (host -> socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind (host -> socket, address) < 0))
+    if (host -> socket == ENET_SOCKET_NULL ||
+        (reusePort && enet_socket_set_option (host -> socket, ENET_SOCKOPT_REUSEPORT, 1) < 0) ||
+        (address != NULL && enet_socket_bind (host -> socket, address) < 0))
     {
        if (host -> socket != ENET_SOCKET_NULL)
          enet_socket_destroy (host -> socket);
 
        enet_free (host -> peers);
-       enet_free (host);
+       enet_host_free (host);
 
        return NULL;
     }
@@ -91,6 +161,9 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> receivedAddress.port = 0;
     host -> receivedData = NULL;
     host -> receivedDataLength = 0;
+    host -> receiveBatchCount = 0;
+    host -> receiveBatchIndex = 0;
+    host -> sendBatchCount = 0;
      
     host -> totalSentData = 0;
     host -> totalSentPackets = 0;
@@ -158,7 +231,87 @@ enet_host_destroy (ENetHost * host)
       (* host -> compressor.destroy) (host -> compressor.context);
 
     enet_free (host -> peers);
-    enet_free (host);
+    enet_host_free (host);
+}
+
+/** Creates a group of hosts which share one port, in order to service the hosts by
+    different threads.
+
+    The hosts are created by enet_host_create_shared(). The system picks the host for
+    a datagram by a hash of the sender address over the sockets sharing the port, so
+    a peer stays on the same host only as long as the set of sockets is the same. All
+    sockets are therefore bound before this function returns and are kept open until
+    enet_host_group_destroy(). A thread which stops servicing its host must leave the
+    host to the group, or hand it over to another thread, e.g. by an ENetHostWaiter,
+    instead of destroying it. The peers on it can not be moved to another host.
+
+    @param address the address shared by the hosts; if the port is 0, the port picked for the first host is used by all
+    @param hostCount the number of hosts
+    @param peerCount the maximum number of peers for each host
+    @param channelLimit see enet_host_create()
+    @param incomingBandwidth see enet_host_create()
+    @param outgoingBandwidth see enet_host_create()
+
+    @returns the group on success and NULL on failure
+*/
+ENetHostGroup *
+enet_host_group_create (const ENetAddress * address, size_t hostCount, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    ENetHostGroup * group;
+    ENetAddress sharedAddress = * address;
+
+    if (hostCount == 0)
+      return NULL;
+
+    group = (ENetHostGroup *) enet_malloc (sizeof (ENetHostGroup));
+    if (group == NULL)
+      return NULL;
+
+    group -> hosts = (ENetHost **) enet_malloc (hostCount * sizeof (ENetHost *));
+    if (group -> hosts == NULL)
+    {
+       enet_free (group);
+
+       return NULL;
+    }
+
+    for (group -> hostCount = 0; group -> hostCount < hostCount; ++ group -> hostCount)
+    {
+       ENetHost * host = enet_host_create_shared (& sharedAddress, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth);
+       if (host == NULL)
+       {
+          enet_host_group_destroy (group);
+
+          return NULL;
+       }
+
+       group -> hosts [group -> hostCount] = host;
+
+       if (group -> hostCount == 0)
+         sharedAddress.port = host -> address.port;
+    }
+
+    group -> address = sharedAddress;
+
+    return group;
+}
+
+/** Destroys the group and all its hosts.
+    @param group pointer to the group to destroy
+*/
+void
+enet_host_group_destroy (ENetHostGroup * group)
+{
+    size_t i;
+
+    if (group == NULL)
+      return;
+
+    for (i = 0; i < group -> hostCount; ++ i)
+      enet_host_destroy (group -> hosts [i]);
+
+    enet_free (group -> hosts);
+    enet_free (group);
 }
 
 /** Initiates a connection to a foreign host.
@@ -1197,27 +1197,54 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     int packets;
 
-    for (packets = 0; packets < 256; ++ packets)
+    /* The limit is only checked between batched receives, datagrams already
+       read from the socket are not left in the batch where a wait on the
+       socket does not see them. */
+    for (packets = 0; packets < 256 || host -> receiveBatchIndex < host -> receiveBatchCount; ++ packets)
     {
-       int receivedLength;
-       ENetBuffer buffer;
+       size_t receivedLength;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       if (host -> receiveBatchIndex >= host -> receiveBatchCount)
+       {
+          ENetBuffer buffers [ENET_HOST_RECEIVE_BATCH_COUNT];
+          int receivedCount;
+          size_t i;
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+          for (i = 0; i < host -> receiveBatchLimit; ++ i)
+          {
+             buffers [i].data = & host -> receiveBatchData [i * ENET_PROTOCOL_MAXIMUM_MTU];
+             buffers [i].dataLength = ENET_PROTOCOL_MAXIMUM_MTU;
+          }
 
-       if (receivedLength < 0)
-         return -1;
+          receivedCount = enet_socket_receive_batch (host -> socket,
+                                                     host -> receiveBatchAddresses,
+                                                     buffers,
+                                                     host -> receiveBatchLengths,
+                                                     host -> receiveBatchLimit);
 
-       if (receivedLength == 0)
-         return 0;
+          host -> receiveBatchCount = 0;
+          host -> receiveBatchIndex = 0;
+
+          if (receivedCount < 0)
+            return -1;
+
+          if (receivedCount == 0)
+            return 0;
+
+          host -> receiveBatchCount = receivedCount;
+       }
+
+       receivedLength = host -> receiveBatchLengths [host -> receiveBatchIndex];
 
-       host -> receivedData = host -> packetData [0];
+       host -> receivedAddress = host -> receiveBatchAddresses [host -> receiveBatchIndex];
+       host -> receivedData = & host -> receiveBatchData [host -> receiveBatchIndex * ENET_PROTOCOL_MAXIMUM_MTU];
        host -> receivedDataLength = receivedLength;
+
+       ++ host -> receiveBatchIndex;
+
+       /* A truncated datagram in the batch. */
+       if (receivedLength == 0)
+         continue;
       
        host -> totalReceivedData += receivedLength;
        host -> totalReceivedPackets ++;
@@ -1587,13 +1614,64 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
     return canPing;
 }
 
+static int
+enet_protocol_flush_send_batch (ENetHost * host)
+{
+    int sentLength;
+
+    if (host -> sendBatchCount == 0)
+      return 0;
+
+    sentLength = enet_socket_send_batch (host -> socket, host -> sendBatchAddresses, host -> sendBatchBuffers, host -> sendBatchCount);
+
+    host -> sendBatchCount = 0;
+
+    if (sentLength < 0)
+      return -1;
+
+    host -> totalSentData += sentLength;
+
+    return 0;
+}
+
+static int
+enet_protocol_stage_outgoing_datagram (ENetHost * host, ENetPeer * peer)
+{
+    enet_uint8 * datagram,
+               * data;
+    const ENetBuffer * buffer;
+
+    if (host -> sendBatchCount >= host -> sendBatchLimit &&
+        enet_protocol_flush_send_batch (host) < 0)
+      return -1;
+
+    datagram = & host -> sendBatchData [host -> sendBatchCount * ENET_HOST_SEND_BATCH_DATA_SIZE];
+    data = datagram;
+
+    for (buffer = host -> buffers;
+         buffer < & host -> buffers [host -> bufferCount];
+         ++ buffer)
+    {
+       memcpy (data, buffer -> data, buffer -> dataLength);
+
+       data += buffer -> dataLength;
+    }
+
+    host -> sendBatchAddresses [host -> sendBatchCount] = peer -> address;
+    host -> sendBatchBuffers [host -> sendBatchCount].data = datagram;
+    host -> sendBatchBuffers [host -> sendBatchCount].dataLength = data - datagram;
+
+    ++ host -> sendBatchCount;
+
+    return 0;
+}
+
 static int
 enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
     enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
     ENetPeer * currentPeer;
-    int sentLength;
     size_t shouldCompress = 0;
  
     host -> continueSending = 1;
@@ -1622,7 +1700,7 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
             enet_protocol_check_timeouts (host, currentPeer, event) == 1)
         {
             if (event != NULL && event -> type != ENET_EVENT_TYPE_NONE)
-              return 1;
+              return enet_protocol_flush_send_batch (host) < 0 ? -1 : 1;
             else
               continue;
         }
@@ -1722,18 +1800,15 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        if (enet_protocol_stage_outgoing_datagram (host, currentPeer) < 0)
+          return -1;
 
         enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
-        if (sentLength < 0)
-          return -1;
-
-        host -> totalSentData += sentLength;
         host -> totalSentPackets ++;
     }
    
-    return 0;
+    return enet_protocol_flush_send_batch (host);
 }
 
 /** Sends any queued packets on the host specified to its designated peers.
@@ -4,6 +4,10 @@
 */
 #ifndef _WIN32
 
+#if defined(__linux__) && ! defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -46,6 +50,18 @@
 #endif
 #endif
 
+#ifdef __linux__
+#ifndef HAS_RECVMMSG
+#define HAS_RECVMMSG 1
+#endif
+#ifndef HAS_SENDMMSG
+#define HAS_SENDMMSG 1
+#endif
+#ifndef HAS_EPOLL
+#define HAS_EPOLL 1
+#endif
+#endif
+
 #ifdef HAS_FCNTL
 #include <fcntl.h>
 #endif
@@ -54,6 +70,14 @@
 #include <sys/poll.h>
 #endif
 
+#ifdef HAS_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdint.h>
+
+#define ENET_HOST_WAITER_MAXIMUM_EVENTS 64
+#endif
+
 #ifndef HAS_SOCKLEN_T
 typedef int socklen_t;
 #endif
@@ -313,6 +337,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, SOL_SOCKET, SO_REUSEADDR, (char *) & value, sizeof (int));
             break;
 
+#ifdef SO_REUSEPORT
+        case ENET_SOCKOPT_REUSEPORT:
+            result = setsockopt (socket, SOL_SOCKET, SO_REUSEPORT, (char *) & value, sizeof (int));
+            break;
+#endif
+
         case ENET_SOCKOPT_RCVBUF:
             result = setsockopt (socket, SOL_SOCKET, SO_RCVBUF, (char *) & value, sizeof (int));
             break;
@@ -462,6 +492,108 @@ enet_socket_send (ENetSocket socket,
     return sentLength;
 }
 
+/* An error of the socket itself, not only of the datagram being sent. */
+static int
+enet_socket_send_failed (int error)
+{
+    return error == EBADF || error == ENOTSOCK || error == EFAULT;
+}
+
+/* The number of datagrams sent by one batched send, one without sendmmsg. */
+size_t
+enet_socket_send_batch_limit (void)
+{
+#ifdef HAS_SENDMMSG
+    return ENET_HOST_SEND_BATCH_COUNT;
+#else
+    return 1;
+#endif
+}
+
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t count)
+{
+    int sentLength = 0;
+#ifdef HAS_SENDMMSG
+    struct mmsghdr msgHdrs [ENET_HOST_SEND_BATCH_COUNT];
+    struct sockaddr_in sins [ENET_HOST_SEND_BATCH_COUNT];
+    size_t offset;
+
+    for (offset = 0; offset < count; offset += ENET_HOST_SEND_BATCH_COUNT)
+    {
+        size_t batchCount = count - offset < ENET_HOST_SEND_BATCH_COUNT ? count - offset : ENET_HOST_SEND_BATCH_COUNT,
+               sentCount = 0,
+               i;
+
+        memset (msgHdrs, 0, batchCount * sizeof (struct mmsghdr));
+        memset (sins, 0, batchCount * sizeof (struct sockaddr_in));
+
+        for (i = 0; i < batchCount; ++ i)
+        {
+            sins [i].sin_family = AF_INET;
+            sins [i].sin_port = ENET_HOST_TO_NET_16 (addresses [offset + i].port);
+            sins [i].sin_addr.s_addr = addresses [offset + i].host;
+
+            msgHdrs [i].msg_hdr.msg_name = & sins [i];
+            msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+            msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) & buffers [offset + i];
+            msgHdrs [i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while (sentCount < batchCount)
+        {
+            int result = sendmmsg (socket, & msgHdrs [sentCount], (unsigned int) (batchCount - sentCount), MSG_NOSIGNAL);
+
+            if (result == -1)
+            {
+               if (errno == EINTR)
+                 continue;
+
+               if (enet_socket_send_failed (errno))
+                 return -1;
+
+               /* Drop only the datagram that failed, e.g. it would block, was
+                  refused or is too large, and send the ones to other peers. */
+               ++ sentCount;
+
+               continue;
+            }
+
+            for (i = sentCount; i < sentCount + result; ++ i)
+              sentLength += msgHdrs [i].msg_len;
+
+            sentCount += result;
+        }
+    }
+#else
+    size_t i;
+
+    for (i = 0; i < count; ++ i)
+    {
+        int result;
+
+        do result = enet_socket_send (socket, & addresses [i], & buffers [i], 1);
+        while (result < 0 && errno == EINTR);
+
+        if (result < 0)
+        {
+            if (enet_socket_send_failed (errno))
+              return -1;
+
+            /* Drop only the datagram that failed. */
+            continue;
+        }
+
+        sentLength += result;
+    }
+#endif
+
+    return sentLength;
+}
+
 int
 enet_socket_receive (ENetSocket socket,
                      ENetAddress * address,
@@ -507,6 +639,85 @@ enet_socket_receive (ENetSocket socket,
     return recvLength;
 }
 
+/* The number of datagrams read by one batched receive, one without recvmmsg. */
+size_t
+enet_socket_receive_batch_limit (void)
+{
+#ifdef HAS_RECVMMSG
+    return ENET_HOST_RECEIVE_BATCH_COUNT;
+#else
+    return 1;
+#endif
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t * receivedLengths,
+                           size_t count)
+{
+#ifdef HAS_RECVMMSG
+    struct mmsghdr msgHdrs [ENET_HOST_RECEIVE_BATCH_COUNT];
+    struct sockaddr_in sins [ENET_HOST_RECEIVE_BATCH_COUNT];
+    int recvCount, i;
+
+    if (count > ENET_HOST_RECEIVE_BATCH_COUNT)
+      count = ENET_HOST_RECEIVE_BATCH_COUNT;
+
+    memset (msgHdrs, 0, count * sizeof (struct mmsghdr));
+
+    for (i = 0; i < (int) count; ++ i)
+    {
+        msgHdrs [i].msg_hdr.msg_name = & sins [i];
+        msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) & buffers [i];
+        msgHdrs [i].msg_hdr.msg_iovlen = 1;
+    }
+
+    recvCount = recvmmsg (socket, msgHdrs, (unsigned int) count, MSG_NOSIGNAL, NULL);
+
+    if (recvCount == -1)
+    {
+       if (errno == EWOULDBLOCK)
+         return 0;
+
+       return -1;
+    }
+
+    for (i = 0; i < recvCount; ++ i)
+    {
+        addresses [i].host = (enet_uint32) sins [i].sin_addr.s_addr;
+        addresses [i].port = ENET_NET_TO_HOST_16 (sins [i].sin_port);
+
+        /* A truncated datagram is skipped, not the whole batch. */
+        if (msgHdrs [i].msg_hdr.msg_flags & MSG_TRUNC)
+          receivedLengths [i] = 0;
+        else
+          receivedLengths [i] = msgHdrs [i].msg_len;
+    }
+
+    return recvCount;
+#else
+    size_t recvCount;
+
+    for (recvCount = 0; recvCount < count; ++ recvCount)
+    {
+        int recvLength = enet_socket_receive (socket, & addresses [recvCount], & buffers [recvCount], 1);
+
+        if (recvLength < 0)
+          return recvCount > 0 ? (int) recvCount : -1;
+
+        if (recvLength == 0)
+          break;
+
+        receivedLengths [recvCount] = recvLength;
+    }
+
+    return (int) recvCount;
+#endif
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -606,5 +817,433 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
 #endif
 }
 
+/* Datagrams read by a batched receive of the host and not handled yet. */
+#define ENET_HOST_RECEIVE_PENDING(host) ((host) -> receiveBatchIndex < (host) -> receiveBatchCount)
+
+struct _ENetHostWaiter
+{
+    ENetHost ** hosts;
+    size_t hostCount;
+    size_t hostCapacity;
+#ifdef HAS_EPOLL
+    int epollFd;
+    int wakeFd;
+#else
+    int wakeFds [2];
+#ifdef HAS_POLL
+    struct pollfd * pollFds;
+    size_t pollCapacity;
+#endif
+#endif
+};
+
+static int
+enet_host_waiter_insert (ENetHostWaiter * waiter, ENetHost * host)
+{
+    if (waiter -> hostCount >= waiter -> hostCapacity)
+    {
+        size_t hostCapacity = waiter -> hostCapacity > 0 ? 2 * waiter -> hostCapacity : 8;
+        ENetHost ** hosts = (ENetHost **) enet_malloc (hostCapacity * sizeof (ENetHost *));
+
+        if (hosts == NULL)
+          return -1;
+
+        if (waiter -> hosts != NULL)
+        {
+            memcpy (hosts, waiter -> hosts, waiter -> hostCount * sizeof (ENetHost *));
+
+            enet_free (waiter -> hosts);
+        }
+
+        waiter -> hosts = hosts;
+        waiter -> hostCapacity = hostCapacity;
+    }
+
+    waiter -> hosts [waiter -> hostCount ++] = host;
+
+    return 0;
+}
+
+static int
+enet_host_waiter_erase (ENetHostWaiter * waiter, ENetHost * host)
+{
+    size_t i;
+
+    for (i = 0; i < waiter -> hostCount; ++ i)
+    {
+        if (waiter -> hosts [i] == host)
+        {
+            waiter -> hosts [i] = waiter -> hosts [-- waiter -> hostCount];
+
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+#ifdef HAS_EPOLL
+
+ENetHostWaiter *
+enet_host_waiter_create (void)
+{
+    ENetHostWaiter * waiter = (ENetHostWaiter *) enet_malloc (sizeof (ENetHostWaiter));
+    struct epoll_event event;
+
+    if (waiter == NULL)
+      return NULL;
+
+    waiter -> hosts = NULL;
+    waiter -> hostCount = 0;
+    waiter -> hostCapacity = 0;
+    waiter -> epollFd = epoll_create1 (EPOLL_CLOEXEC);
+    waiter -> wakeFd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    memset (& event, 0, sizeof (struct epoll_event));
+
+    /* The wake up fd is marked by a NULL host. */
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+
+    if (waiter -> epollFd == -1 ||
+        waiter -> wakeFd == -1 ||
+        epoll_ctl (waiter -> epollFd, EPOLL_CTL_ADD, waiter -> wakeFd, & event) == -1)
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return NULL;
+    }
+
+    return waiter;
+}
+
+void
+enet_host_waiter_destroy (ENetHostWaiter * waiter)
+{
+    if (waiter -> epollFd != -1)
+      close (waiter -> epollFd);
+
+    if (waiter -> wakeFd != -1)
+      close (waiter -> wakeFd);
+
+    if (waiter -> hosts != NULL)
+      enet_free (waiter -> hosts);
+
+    enet_free (waiter);
+}
+
+int
+enet_host_waiter_add (ENetHostWaiter * waiter, ENetHost * host)
+{
+    struct epoll_event event;
+
+    memset (& event, 0, sizeof (struct epoll_event));
+
+    /* Level-triggered, a host not serviced until empty is reported again. */
+    event.events = EPOLLIN;
+    event.data.ptr = host;
+
+    if (enet_host_waiter_insert (waiter, host) < 0)
+      return -1;
+
+    if (epoll_ctl (waiter -> epollFd, EPOLL_CTL_ADD, host -> socket, & event) == -1)
+    {
+        enet_host_waiter_erase (waiter, host);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+int
+enet_host_waiter_remove (ENetHostWaiter * waiter, ENetHost * host)
+{
+    struct epoll_event event;
+
+    memset (& event, 0, sizeof (struct epoll_event));
+
+    if (enet_host_waiter_erase (waiter, host) < 0)
+      return -1;
+
+    return epoll_ctl (waiter -> epollFd, EPOLL_CTL_DEL, host -> socket, & event) == -1 ? -1 : 0;
+}
+
+int
+enet_host_waiter_wake (ENetHostWaiter * waiter)
+{
+    uint64_t value = 1;
+
+    if (write (waiter -> wakeFd, & value, sizeof (value)) == -1 && errno != EAGAIN)
+      return -1;
+
+    return 0;
+}
+
+int
+enet_host_waiter_wait (ENetHostWaiter * waiter, ENetHost ** hosts, size_t hostLimit, enet_uint32 timeout)
+{
+    struct epoll_event events [ENET_HOST_WAITER_MAXIMUM_EVENTS];
+    size_t readyCount = 0,
+           pendingCount,
+           i,
+           j;
+    int eventLimit,
+        eventCount;
+
+    /* The socket does not report datagrams already read by the host. */
+    for (i = 0; i < waiter -> hostCount && readyCount < hostLimit; ++ i)
+    {
+        if (ENET_HOST_RECEIVE_PENDING (waiter -> hosts [i]))
+          hosts [readyCount ++] = waiter -> hosts [i];
+    }
+
+    pendingCount = readyCount;
+
+    if (pendingCount > 0)
+      timeout = 0;
+
+    /* Room for the hosts and the wake up fd. Hosts left out are level-triggered
+       and reported by the next wait. */
+    eventLimit = hostLimit - readyCount + 1 < ENET_HOST_WAITER_MAXIMUM_EVENTS ? (int) (hostLimit - readyCount) + 1 : ENET_HOST_WAITER_MAXIMUM_EVENTS;
+
+    eventCount = epoll_wait (waiter -> epollFd, events, eventLimit, (int) timeout);
+
+    if (eventCount < 0)
+      return errno == EINTR ? (int) readyCount : -1;
+
+    for (i = 0; i < (size_t) eventCount; ++ i)
+    {
+        ENetHost * host = (ENetHost *) events [i].data.ptr;
+
+        if (host == NULL)
+        {
+            uint64_t value;
+
+            while (read (waiter -> wakeFd, & value, sizeof (value)) > 0)
+              ;
+
+            continue;
+        }
+
+        for (j = 0; j < pendingCount; ++ j)
+        {
+            if (hosts [j] == host)
+              break;
+        }
+
+        if (j == pendingCount && readyCount < hostLimit)
+          hosts [readyCount ++] = host;
+    }
+
+    return (int) readyCount;
+}
+
+#else
+
+ENetHostWaiter *
+enet_host_waiter_create (void)
+{
+    ENetHostWaiter * waiter = (ENetHostWaiter *) enet_malloc (sizeof (ENetHostWaiter));
+
+    if (waiter == NULL)
+      return NULL;
+
+    waiter -> hosts = NULL;
+    waiter -> hostCount = 0;
+    waiter -> hostCapacity = 0;
+
+    if (pipe (waiter -> wakeFds) == -1)
+    {
+        enet_free (waiter);
+
+        return NULL;
+    }
+
+#ifdef HAS_POLL
+    /* Room for the wake up fd and a few hosts, grown by enet_host_waiter_add. */
+    waiter -> pollCapacity = 9;
+    waiter -> pollFds = (struct pollfd *) enet_malloc (waiter -> pollCapacity * sizeof (struct pollfd));
+
+    if (waiter -> pollFds == NULL)
+#else
+    if (waiter -> wakeFds [0] >= FD_SETSIZE)
+#endif
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return NULL;
+    }
+
+    enet_socket_set_option (waiter -> wakeFds [0], ENET_SOCKOPT_NONBLOCK, 1);
+    enet_socket_set_option (waiter -> wakeFds [1], ENET_SOCKOPT_NONBLOCK, 1);
+
+    return waiter;
+}
+
+void
+enet_host_waiter_destroy (ENetHostWaiter * waiter)
+{
+    close (waiter -> wakeFds [0]);
+    close (waiter -> wakeFds [1]);
+
+#ifdef HAS_POLL
+    if (waiter -> pollFds != NULL)
+      enet_free (waiter -> pollFds);
+#endif
+
+    if (waiter -> hosts != NULL)
+      enet_free (waiter -> hosts);
+
+    enet_free (waiter);
+}
+
+int
+enet_host_waiter_add (ENetHostWaiter * waiter, ENetHost * host)
+{
+#ifdef HAS_POLL
+    /* The wake up fd and the hosts, the content is set by each wait. */
+    if (waiter -> hostCount + 2 > waiter -> pollCapacity)
+    {
+        size_t pollCapacity = 2 * waiter -> pollCapacity;
+        struct pollfd * pollFds = (struct pollfd *) enet_malloc (pollCapacity * sizeof (struct pollfd));
+
+        if (pollFds == NULL)
+          return -1;
+
+        enet_free (waiter -> pollFds);
+
+        waiter -> pollFds = pollFds;
+        waiter -> pollCapacity = pollCapacity;
+    }
+#else
+    /* A larger fd would be written past the fd_set. */
+    if (host -> socket >= FD_SETSIZE)
+      return -1;
+#endif
+
+    return enet_host_waiter_insert (waiter, host);
+}
+
+int
+enet_host_waiter_remove (ENetHostWaiter * waiter, ENetHost * host)
+{
+    return enet_host_waiter_erase (waiter, host);
+}
+
+int
+enet_host_waiter_wake (ENetHostWaiter * waiter)
+{
+    char byte = 0;
+
+    if (write (waiter -> wakeFds [1], & byte, 1) == -1 && errno != EWOULDBLOCK)
+      return -1;
+
+    return 0;
+}
+
+int
+enet_host_waiter_wait (ENetHostWaiter * waiter, ENetHost ** hosts, size_t hostLimit, enet_uint32 timeout)
+{
+#ifdef HAS_POLL
+    struct pollfd * pollFds = waiter -> pollFds;
+    int pollCount,
+        readyCount = 0;
+    size_t i;
+
+    pollFds [0].fd = waiter -> wakeFds [0];
+    pollFds [0].events = POLLIN;
+
+    for (i = 0; i < waiter -> hostCount; ++ i)
+    {
+        pollFds [i + 1].fd = waiter -> hosts [i] -> socket;
+        pollFds [i + 1].events = POLLIN;
+
+        /* The socket does not report datagrams already read by the host. */
+        if (ENET_HOST_RECEIVE_PENDING (waiter -> hosts [i]))
+          timeout = 0;
+    }
+
+    pollCount = poll (pollFds, waiter -> hostCount + 1, (int) timeout);
+
+    if (pollCount < 0)
+    {
+        if (errno != EINTR)
+          return -1;
+
+        for (i = 0; i <= waiter -> hostCount; ++ i)
+          pollFds [i].revents = 0;
+    }
+
+    if (pollFds [0].revents & POLLIN)
+    {
+        char data [16];
+
+        while (read (waiter -> wakeFds [0], data, sizeof (data)) > 0)
+          ;
+    }
+
+    for (i = 0; i < waiter -> hostCount && (size_t) readyCount < hostLimit; ++ i)
+    {
+        if (pollFds [i + 1].revents != 0 || ENET_HOST_RECEIVE_PENDING (waiter -> hosts [i]))
+          hosts [readyCount ++] = waiter -> hosts [i];
+    }
+
+    return readyCount;
+#else
+    fd_set readSet;
+    struct timeval timeVal;
+    int maxSocket = waiter -> wakeFds [0],
+        selectCount,
+        readyCount = 0;
+    size_t i;
+
+    FD_ZERO (& readSet);
+    FD_SET (waiter -> wakeFds [0], & readSet);
+
+    for (i = 0; i < waiter -> hostCount; ++ i)
+    {
+        FD_SET (waiter -> hosts [i] -> socket, & readSet);
+
+        if (waiter -> hosts [i] -> socket > maxSocket)
+          maxSocket = waiter -> hosts [i] -> socket;
+
+        /* The socket does not report datagrams already read by the host. */
+        if (ENET_HOST_RECEIVE_PENDING (waiter -> hosts [i]))
+          timeout = 0;
+    }
+
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+
+    selectCount = select (maxSocket + 1, & readSet, NULL, NULL, & timeVal);
+
+    if (selectCount < 0)
+    {
+        if (errno != EINTR)
+          return -1;
+
+        FD_ZERO (& readSet);
+    }
+
+    if (FD_ISSET (waiter -> wakeFds [0], & readSet))
+    {
+        char data [16];
+
+        while (read (waiter -> wakeFds [0], data, sizeof (data)) > 0)
+          ;
+    }
+
+    for (i = 0; i < waiter -> hostCount && (size_t) readyCount < hostLimit; ++ i)
+    {
+        if (FD_ISSET (waiter -> hosts [i] -> socket, & readSet) || ENET_HOST_RECEIVE_PENDING (waiter -> hosts [i]))
+          hosts [readyCount ++] = waiter -> hosts [i];
+    }
+
+    return readyCount;
+#endif
+}
+
 #endif
 
+#endif
@@ -326,6 +326,42 @@ enet_socket_send (ENetSocket socket,
     return (int) sentLength;
 }
 
+/* The number of datagrams sent by one batched send, sendmmsg is not available. */
+size_t
+enet_socket_send_batch_limit (void)
+{
+    return 1;
+}
+
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t count)
+{
+    int sentLength = 0;
+    size_t i;
+
+    for (i = 0; i < count; ++ i)
+    {
+        int result = enet_socket_send (socket, & addresses [i], & buffers [i], 1);
+
+        if (result < 0)
+        {
+            if (WSAGetLastError () == WSAENOTSOCK)
+              return -1;
+
+            /* Drop only the datagram that failed, e.g. it was refused, and
+               send the ones to other peers. */
+            continue;
+        }
+
+        sentLength += result;
+    }
+
+    return sentLength;
+}
+
 int
 enet_socket_receive (ENetSocket socket,
                      ENetAddress * address,
@@ -369,6 +405,38 @@ enet_socket_receive (ENetSocket socket,
     return (int) recvLength;
 }
 
+/* The number of datagrams read by one batched receive, recvmmsg is not available. */
+size_t
+enet_socket_receive_batch_limit (void)
+{
+    return 1;
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t * receivedLengths,
+                           size_t count)
+{
+    size_t recvCount;
+
+    for (recvCount = 0; recvCount < count; ++ recvCount)
+    {
+        int recvLength = enet_socket_receive (socket, & addresses [recvCount], & buffers [recvCount], 1);
+
+        if (recvLength < 0)
+          return recvCount > 0 ? (int) recvCount : -1;
+
+        if (recvLength == 0)
+          break;
+
+        receivedLengths [recvCount] = recvLength;
+    }
+
+    return (int) recvCount;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -416,7 +484,167 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
       * condition |= ENET_SOCKET_WAIT_RECEIVE;
 
     return 0;
-} 
+}
 
-#endif
+struct _ENetHostWaiter
+{
+    ENetHost ** hosts;
+    size_t hostCount;
+    size_t hostCapacity;
+    ENetSocket wakeSocket;
+    ENetAddress wakeAddress;
+};
+
+ENetHostWaiter *
+enet_host_waiter_create (void)
+{
+    ENetHostWaiter * waiter = (ENetHostWaiter *) enet_malloc (sizeof (ENetHostWaiter));
+
+    if (waiter == NULL)
+      return NULL;
+
+    waiter -> hosts = NULL;
+    waiter -> hostCount = 0;
+    waiter -> hostCapacity = 0;
+
+    /* Wake ups are sent to a loopback datagram socket, since select only works on sockets. */
+    waiter -> wakeAddress.host = ENET_HOST_TO_NET_32 (0x7F000001);
+    waiter -> wakeAddress.port = 0;
+    waiter -> wakeSocket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
+
+    if (waiter -> wakeSocket == ENET_SOCKET_NULL ||
+        enet_socket_bind (waiter -> wakeSocket, & waiter -> wakeAddress) < 0 ||
+        enet_socket_get_address (waiter -> wakeSocket, & waiter -> wakeAddress) < 0 ||
+        enet_socket_set_option (waiter -> wakeSocket, ENET_SOCKOPT_NONBLOCK, 1) < 0)
+    {
+        enet_host_waiter_destroy (waiter);
+
+        return NULL;
+    }
+
+    return waiter;
+}
+
+void
+enet_host_waiter_destroy (ENetHostWaiter * waiter)
+{
+    enet_socket_destroy (waiter -> wakeSocket);
+
+    if (waiter -> hosts != NULL)
+      enet_free (waiter -> hosts);
+
+    enet_free (waiter);
+}
+
+int
+enet_host_waiter_add (ENetHostWaiter * waiter, ENetHost * host)
+{
+    if (waiter -> hostCount + 1 >= FD_SETSIZE)
+      return -1;
+
+    if (waiter -> hostCount >= waiter -> hostCapacity)
+    {
+        size_t hostCapacity = waiter -> hostCapacity > 0 ? 2 * waiter -> hostCapacity : 8;
+        ENetHost ** hosts = (ENetHost **) enet_malloc (hostCapacity * sizeof (ENetHost *));
+
+        if (hosts == NULL)
+          return -1;
+
+        if (waiter -> hosts != NULL)
+        {
+            memcpy (hosts, waiter -> hosts, waiter -> hostCount * sizeof (ENetHost *));
+
+            enet_free (waiter -> hosts);
+        }
+
+        waiter -> hosts = hosts;
+        waiter -> hostCapacity = hostCapacity;
+    }
+
+    waiter -> hosts [waiter -> hostCount ++] = host;
+
+    return 0;
+}
+
+int
+enet_host_waiter_remove (ENetHostWaiter * waiter, ENetHost * host)
+{
+    size_t i;
+
+    for (i = 0; i < waiter -> hostCount; ++ i)
+    {
+        if (waiter -> hosts [i] == host)
+        {
+            waiter -> hosts [i] = waiter -> hosts [-- waiter -> hostCount];
+
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+int
+enet_host_waiter_wake (ENetHostWaiter * waiter)
+{
+    char byte = 0;
+    ENetBuffer buffer;
+
+    buffer.data = & byte;
+    buffer.dataLength = 1;
+
+    return enet_socket_send (waiter -> wakeSocket, & waiter -> wakeAddress, & buffer, 1) < 0 ? -1 : 0;
+}
 
+int
+enet_host_waiter_wait (ENetHostWaiter * waiter, ENetHost ** hosts, size_t hostLimit, enet_uint32 timeout)
+{
+    fd_set readSet;
+    struct timeval timeVal;
+    int selectCount,
+        readyCount = 0;
+    size_t i;
+
+    FD_ZERO (& readSet);
+    FD_SET (waiter -> wakeSocket, & readSet);
+
+    for (i = 0; i < waiter -> hostCount; ++ i)
+    {
+        FD_SET (waiter -> hosts [i] -> socket, & readSet);
+
+        /* The socket does not report datagrams already read by the host. */
+        if (waiter -> hosts [i] -> receiveBatchIndex < waiter -> hosts [i] -> receiveBatchCount)
+          timeout = 0;
+    }
+
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+
+    selectCount = select (0, & readSet, NULL, NULL, & timeVal);
+
+    if (selectCount < 0)
+      return -1;
+
+    if (FD_ISSET (waiter -> wakeSocket, & readSet))
+    {
+        char data [16];
+        ENetBuffer buffer;
+
+        buffer.data = data;
+        buffer.dataLength = sizeof (data);
+
+        while (enet_socket_receive (waiter -> wakeSocket, NULL, & buffer, 1) > 0)
+          ;
+    }
+
+    for (i = 0; i < waiter -> hostCount && (size_t) readyCount < hostLimit; ++ i)
+    {
+        if (FD_ISSET (waiter -> hosts [i] -> socket, & readSet) ||
+            waiter -> hosts [i] -> receiveBatchIndex < waiter -> hosts [i] -> receiveBatchCount)
+          hosts [readyCount ++] = waiter -> hosts [i];
+    }
+
+    return readyCount;
+}
+
+#endif
@@ -0,0 +1,86 @@
+/** 
+ @file  receivebatch.c
+ @brief Test that a host handles all datagrams read by a batched receive
+*/
+#include <stdio.h>
+#include <enet/enet.h>
+
+#define TEST_EVENT_DATAGRAMS 11
+#define TEST_DATAGRAMS (TEST_EVENT_DATAGRAMS + 256 + 10)
+
+static int interceptedCount = 0;
+
+/* Counts the datagrams, the one starting with 'e' results in an event. */
+static int ENET_CALLBACK
+intercept (ENetHost * host, ENetEvent * event)
+{
+    ++ interceptedCount;
+
+    if (host -> receivedData [0] == 'e')
+    {
+        event -> type = ENET_EVENT_TYPE_CONNECT;
+        event -> peer = NULL;
+    }
+
+    return 1;
+}
+
+int
+main (void)
+{
+    ENetAddress address;
+    ENetHost * host;
+    ENetSocket socket;
+    ENetEvent event;
+    int i, result;
+
+    if (enet_initialize () != 0)
+      return 1;
+
+    enet_address_set_host (& address, "127.0.0.1");
+    address.port = 0;
+
+    host = enet_host_create (& address, 1, 1, 0, 0);
+    socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
+    if (host == NULL || socket == ENET_SOCKET_NULL)
+      return 1;
+
+    host -> intercept = intercept;
+
+    /* The event stops the first service inside a batch, the second service
+       then reaches the limit of 256 datagrams inside a batch. */
+    for (i = 0; i < TEST_DATAGRAMS; ++ i)
+    {
+        char data = i == TEST_EVENT_DATAGRAMS - 1 ? 'e' : 'd';
+        ENetBuffer buffer;
+
+        buffer.data = & data;
+        buffer.dataLength = 1;
+
+        if (enet_socket_send (socket, & host -> address, & buffer, 1) != 1)
+          return 1;
+    }
+
+    result = enet_host_service (host, & event, 0);
+    if (result != 1 || interceptedCount != TEST_EVENT_DATAGRAMS)
+    {
+        printf ("first service=%d handled=%d\n", result, interceptedCount);
+        return 1;
+    }
+
+    /* Reaching the limit returns -1, but all datagrams read from the socket
+       must be handled, the socket does not signal the ones left in the batch. */
+    result = enet_host_service (host, & event, 0);
+    printf ("service=%d handled=%d batch left=%d\n", result, interceptedCount,
+            (int) (host -> receiveBatchCount - host -> receiveBatchIndex));
+
+    /* Without batched receives the datagrams over the limit are left in the socket. */
+    result = host -> receiveBatchIndex >= host -> receiveBatchCount &&
+             (host -> receiveBatchLimit == 1 || interceptedCount == TEST_DATAGRAMS);
+
+    enet_socket_destroy (socket);
+    enet_host_destroy (host);
+    enet_deinitialize ();
+
+    return result ? 0 : 1;
+}
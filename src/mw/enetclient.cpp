@@ -1,5 +1,7 @@
 #include "enetclient.h"
 
+#include <enet/time.h>
+
 #include <algorithm>
 #include <string>
 #include <iostream>
@@ -10,8 +12,11 @@ namespace mw {
 		status_ = NOT_ACTIVE;
 		enet_address_set_host(&address_, ip.c_str());
 		address_.port = port;
+		rosterVersion_ = 0;
+		gapTime_ = 0;
 		id_ = -1;
 		peer_ = 0;
+		client_ = 0;
 	}
 
 	EnetClient::~EnetClient() {
@@ -31,28 +36,31 @@ namespace mw {
 	void EnetClient::start() {
 		std::lock_guard<std::mutex> lock(mutex_);
 		if (status_ == NOT_ACTIVE) {
+			// The previous network thread is finished when the status is not active.
+			if (thread_.joinable()) {
+				thread_.join();
+			}
 			status_ = ACTIVE;
 
 			id_ = -1;
 			peer_ = 0;
+			ids_.clear();
+			rosterVersion_ = 0;
+			heldChanges_.clear();
 
 			// Remove old package.
-			while (!sendPackets_.empty()) {
-				sendPackets_.pop();
-			}
-			while (!receivePackets_.empty()) {
-				receivePackets_.pop();
-			}
+			clearBuffers();
 
 			// Create a host using enet_host_create
-			client_ = enet_host_create(NULL, 1, 2, 0, 0);
+			client_ = enet_host_create(NULL, 1, CHANNELS, 0, 0);
 
 			if (client_ == 0) {
 				std::cerr << "An error occured while trying to create an ENet server host" << std::endl;
 				exit(EXIT_FAILURE);
 			}
+			initCompression(client_);
 
-			peer_ = enet_host_connect(client_, &address_, 2, 0);
+			peer_ = enet_host_connect(client_, &address_, CHANNELS, 0);
 
 			if (peer_ == 0) {
 				std::cerr << "No available peers for initializing an ENet connection" << std::endl;
@@ -63,25 +71,25 @@ namespace mw {
 	}
 
 	void EnetClient::stop() {
-		std::lock_guard<std::mutex> lock(mutex_);
-		if (status_ == ACTIVE) {
-			status_ = DISCONNECTING;
-			if (peer_ != 0) {
-				enet_peer_disconnect(peer_, 0);
-			}
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			// The network thread disconnects the peer. Compare, in order to not
+			// overwrite the network thread setting the status to not active.
+			Status active = ACTIVE;
+			status_.compare_exchange_strong(active, DISCONNECTING);
 		}
+		wakeup_.wakeUp();
 	}
 
 	void EnetClient::update() {
-		mutex_.lock();
-		Status tmp = status_;
-		mutex_.unlock();
-		while (tmp != NOT_ACTIVE) {
-			mutex_.lock();
+		setNetworkThread();
+		wakeup_.setHost(client_);
+		std::vector<InternalPacket> inbox; // Taken from the inbox.
+		Status status = status_;
+		while (status != NOT_ACTIVE) {
+			// Enet is only used by the network thread.
 			ENetEvent eNetEvent;
-			int eventStatus = 0;
-			while (status_ != NOT_ACTIVE &&
-				(eventStatus = enet_host_service(client_, &eNetEvent, 0)) > 0) {
+			while (enet_host_service(client_, &eNetEvent, 0) > 0) {
 				switch (eNetEvent.type) {
 					case ENET_EVENT_TYPE_CONNECT:
 						printf("(Client) We got a new connection from %x\n", eNetEvent.peer->address.host);
@@ -89,10 +97,11 @@ namespace mw {
 						break;
 					case ENET_EVENT_TYPE_RECEIVE:
 						if (status_ != NOT_ACTIVE) {
-							// Add to receive buffer.
+							// Add to receive buffer. The data stays in the enet packet.
 							InternalPacket iPacket = receive(eNetEvent);
-							if (iPacket.data_.size() > 0) {
-								receivePackets_.push(iPacket);
+							if (iPacket.eNetPacket_.size() > 0) {
+								pushToReceiveBuffer(std::move(iPacket));
+								break;
 							}
 						} else {
 							std::cerr << "Client receives data, STATUS == NOT_ACTIVE" << std::endl;
@@ -112,56 +121,187 @@ namespace mw {
 				}
 			}
 
-			// Send all packets in send buffert to all clients.
-			// Must been assinged id and got a connection and not active
-			while (id_ != -1 && id_ != 0 && peer_ != 0 && status_ != NOT_ACTIVE && !sendPackets_.empty()) {
-				InternalPacket iPacket = sendPackets_.front();
-
-				ENetPacket* eNetPacket = createEnetPacket(iPacket.data_, iPacket.toId_, iPacket.type_); // id is set to be the client which will receive it. id = 0 means every client.
+			status = status_;
 
-				// Send the packet to the peer over channel id 0.
-				// One could also broadcast the packet by
-				// enet handles the cleen up of eNetPacket;
-				enet_peer_send(peer_, 0, eNetPacket);
+			// The missing change of the client list did not arrive in time.
+			if (!heldChanges_.empty() && ENET_TIME_DIFFERENCE(enet_time_get(), gapTime_) >= ROSTER_GAP_TIMEOUT) {
+				sendRosterRequest();
+				gapTime_ = enet_time_get();
+			}
 
-				// Cleen up.
-				sendPackets_.pop();
+			// Send all packets in send buffert to all clients.
+			// Must been assinged id and got a connection and not active.
+			if (id_ != -1 && id_ != 0 && peer_ != 0 && status != NOT_ACTIVE) {
+				InternalPacket iPacket;
+				while (sendPackets_.pop(iPacket)) {
+					queueSendPacket(iPacket);
+				}
+				// Pushed by a network thread.
+				takeInbox(inbox);
+				for (InternalPacket& iPacket : inbox) {
+					if (iPacket.toId_ == id_) {
+						pushToReceiveBuffer(std::move(iPacket));
+					} else {
+						queueSendPacket(iPacket);
+					}
+				}
+				inbox.clear();
+				flushAggregate();
 			}
 
+			// Give the game thread the packets which did not fit earlier.
+			flushReceiveOverflow();
+
+			// Send directly, don't wait for the next service.
+			enet_host_flush(client_);
+
 			// The client is not active? Or disconnecting is finished?
-			if (status_ == NOT_ACTIVE || status_ == DISCONNECTING) {
+			if (status == NOT_ACTIVE || status == DISCONNECTING) {
 				if (peer_ != 0) {
-					enet_peer_reset(peer_);
+					enet_peer_disconnect_now(peer_, 0);
 					peer_ = 0;
 				}
-				enet_host_flush(client_);
+				wakeup_.setHost(0);
 				enet_host_destroy(client_);
 				client_ = 0;
+
+				id_ = -1;
 				status_ = NOT_ACTIVE;
+				status = NOT_ACTIVE;
+			} else {
+				// Sleep until data is received, data is pushed to the send buffer
+				// or enet needs to be serviced.
+				enet_uint32 timeout = getServiceTimeout(client_);
+				if (!heldChanges_.empty() && timeout > ROSTER_GAP_TIMEOUT) {
+					timeout = ROSTER_GAP_TIMEOUT;
+				}
+				wakeup_.wait(timeout);
+			}
+		}
+	}
+
+	void EnetClient::sendPacket(InternalPacket& iPacket) {
+		// id is set to be the client which will receive it. id = 0 means every client.
+		// Room for the own id makes the server able to relay the packet as it is.
+		ENetPacket* eNetPacket = createEnetPacket(iPacket, iPacket.toId_, EnetPacket::idSize(id_));
+
+		// enet handles the cleen up of eNetPacket;
+		if (eNetPacket != 0 && enet_peer_send(peer_, iPacket.channel_, eNetPacket) < 0) {
+			enet_packet_destroy(eNetPacket);
+		}
+	}
+
+	void EnetClient::sendRosterRequest() {
+		// [0]=type,[1]=id, not used.
+		char data[2] = {ROSTER_REQUEST, 0};
+		ENetPacket* eNetPacket = enet_packet_create(data, sizeof(data), ENET_PACKET_FLAG_RELIABLE);
+		if (peer_ == 0 || enet_peer_send(peer_, 0, eNetPacket) < 0) {
+			enet_packet_destroy(eNetPacket);
+		}
+	}
+
+	void EnetClient::applyRosterChange(char type, int id) {
+		if (type == JOIN_INFO) {
+			ids_.push_back(id);
+		} else {
+			auto it = std::find(ids_.begin(), ids_.end(), id);
+			if (it != ids_.end()) {
+				ids_.erase(it);
 			}
+		}
+	}
 
-			tmp = status_;
-			mutex_.unlock();
-			std::chrono::milliseconds duration(50);
-			std::this_thread::sleep_for(duration);
+	void EnetClient::applyHeldRosterChanges() {
+		heldChanges_.erase(heldChanges_.begin(), heldChanges_.upper_bound(rosterVersion_));
+		bool applied = false;
+		while (!heldChanges_.empty() && heldChanges_.begin()->first == rosterVersion_ + 1) {
+			applyRosterChange(heldChanges_.begin()->second.first, heldChanges_.begin()->second.second);
+			rosterVersion_ = heldChanges_.begin()->first;
+			heldChanges_.erase(heldChanges_.begin());
+			applied = true;
+		}
+		if (applied) {
+			// Wait anew for the next missing change.
+			gapTime_ = enet_time_get();
 		}
 	}
 
 	EnetClient::InternalPacket EnetClient::receive(ENetEvent eNetEvent) {
 		ENetPacket* packet = eNetEvent.packet;
-		char type = packet->data[0];
-		char id = packet->data[1];
+		const char* data = (const char*) packet->data;
+		int size = (int) packet->dataLength;
+		int id;
+		int index;
+		if (size < 1 || (index = EnetPacket::readId(data + 1, size - 1, id)) == 0) {
+			// Not a valid header.
+			return InternalPacket(Packet(), 0, PacketType::RELIABLE);
+		}
+		++index;
+		char type = data[0];
 		switch (type) {
 			case CONNECT_INFO:
+			{
+				// [0]=type,[1...]=id,[...]=version,[...] = ids of all clients
+				int bytes = EnetPacket::readId(data + index, size - index, rosterVersion_);
+				if (bytes == 0) {
+					break;
+				}
+				index += bytes;
 				id_ = id;
 				ids_.clear();
-				for (unsigned int i = 2; i < packet->dataLength; ++i) {
-					ids_.push_back(packet->data[i]);
+				while (index < size) {
+					int bytes = EnetPacket::readId(data + index, size - index, id);
+					if (bytes == 0) {
+						break;
+					}
+					ids_.push_back(id);
+					index += bytes;
+				}
+				applyHeldRosterChanges();
+			}
+				break;
+			case JOIN_INFO:
+			case LEAVE_INFO:
+			{
+				// [0]=type,[1...]=id,[...]=version
+				int version;
+				if (id_ <= 0 || EnetPacket::readId(data + index, size - index, version) == 0) {
+					break;
+				}
+				if (version <= rosterVersion_) {
+					// Already part of the client list, e.g. a relayed change
+					// arriving after the CONNECT_INFO.
+					break;
 				}
+				if (version != rosterVersion_ + 1) {
+					// An earlier change is missing, wait for it a while before
+					// asking for all clients.
+					if (heldChanges_.empty()) {
+						gapTime_ = enet_time_get();
+					}
+					heldChanges_[version] = std::make_pair(type, id);
+					break;
+				}
+				applyRosterChange(type, id);
+				rosterVersion_ = version;
+				applyHeldRosterChanges();
+			}
 				break;
 			case PACKET:
-				//[0]=type,[1]=id,[2...] = data
-				return InternalPacket(Packet((char*) packet->data + 2, packet->dataLength - 2), id, PacketType::RELIABLE); // Doesn't matter which packet type!
+				// [0]=type,[1...]=id,[...] = data
+				if (size > index) {
+					InternalPacket iPacket(Packet(), id, PacketType::RELIABLE); // Doesn't matter which packet type!
+					// Take the enet packet, to not copy the data.
+					iPacket.eNetPacket_ = EnetPacket(packet);
+					return iPacket;
+				}
+				break;
+			case AGGREGATE:
+				// [0]=type,[1...]=id,[...] = size,data,size,data...
+				forEachAggregated(data + index, size - index, [&](const char* data, int size) {
+					pushToReceiveBuffer(InternalPacket(Packet(data, size), id, PacketType::RELIABLE));
+				});
+				break;
 		}
 		return InternalPacket(Packet(), 0, PacketType::RELIABLE);
 	}
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <vector>
+#include <map>
 #include <thread>
 #include <mutex>
 
@@ -24,8 +25,29 @@ namespace mw {
 
 		InternalPacket receive(ENetEvent eNetEvent) override;
 
+		// Send the packet to the server.
+		void sendPacket(InternalPacket& iPacket) override;
+
 	private:
-		std::vector<int> ids_;
+		// Called by the network thread. Ask the server for all clients.
+		void sendRosterRequest();
+
+		// Called by the network thread. Add or remove the client in the client list.
+		void applyRosterChange(char type, int id);
+
+		// Called by the network thread. Apply the held back changes following
+		// the current roster version, the older ones are dropped.
+		void applyHeldRosterChanges();
+
+		// The time in milliseconds a change of the client list is held back,
+		// waiting for a missing earlier change, before all clients are asked for.
+		// Changes relayed by different server shards may arrive out of order.
+		static const enet_uint32 ROSTER_GAP_TIMEOUT = 200;
+
+		std::vector<int> ids_; // All clients, kept up to date by the server.
+		int rosterVersion_;
+		std::map<int, std::pair<char, int>> heldChanges_; // Version to held back change, first: type second: id.
+		enet_uint32 gapTime_; // When the missing change was first waited for.
 
 		ENetPeer* peer_;
 		ENetAddress address_;
@@ -1,115 +1,569 @@
 #include "enetnetwork.h"
+#include "lzcompressor.h"
 
 #include <enet/enet.h>
+#include <enet/time.h>
 
 #include <iostream>
 #include <cstdio>
 #include <queue>
 #include <algorithm>
 #include <array>
+#include <cassert>
 
 namespace mw {
 	// ----------------------------------------------------------------------------
 	// To do! Fix that packages cant be sent before a id is assigned to the client.
 	// ----------------------------------------------------------------------------
 
+	namespace {
+
+		// True on the network thread of any EnetNetwork.
+		thread_local bool networkThread = false;
+
+	}
+
 	int EnetNetwork::nbrOfInstances = 0;
 
-	EnetNetwork::EnetNetwork() {
-		// a. Initialize enet
-		if (nbrOfInstances < 1) {
-			++nbrOfInstances;
+	EnetNetwork::EnetNetwork() : sendPackets_(BUFFER_CAPACITY), receivePackets_(BUFFER_CAPACITY), aggregateCount_(0),
+		compression_(NO_COMPRESSION), sentBytes_(0), sentCompressedBytes_(0), receivedCompressedBytes_(0), receivedBytes_(0) {
+		// a. Initialize enet, once for all instances.
+		if (nbrOfInstances++ == 0) {
 			if (enet_initialize() != 0) {
 				fprintf(stderr, "An error occured while initializing ENet.\n");
 				//return EXIT_FAILURE;
 			}
 		}
+		if (!wakeup_.open()) {
+			fprintf(stderr, "An error occured while creating the wake up waiter.\n");
+		}
 	}
 
 	EnetNetwork::~EnetNetwork() {
-		--nbrOfInstances;
-		if (nbrOfInstances < 1) {
+		wakeup_.close();
+		// The last instance deinitializes enet.
+		if (--nbrOfInstances == 0) {
 			enet_deinitialize();
 		}
 	}
 
 	void EnetNetwork::pushToSendBuffer(const Packet& packet, PacketType type, int toId) {
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			// Copy buffert to send buffert. Assign the correct sender id.
-			if (packet.size() > 0) {
-				if (toId == 0) {
-					pushToSendBuffer(packet, type);
+		pushToSendBuffer(packet, type, toId, 0);
+	}
+
+	void EnetNetwork::pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) {
+		push(packet, type, toId, channel, id_);
+	}
+
+	void EnetNetwork::pushToSendBuffer(const Packet& packet, PacketType type) {
+		pushToSendBuffer(packet, type, 0, 0);
+	}
+
+	void EnetNetwork::pushToSendBuffer(const OutgoingPacket* packets, int count) {
+		sendInternalPackets(packets, count, id_);
+	}
+
+	void EnetNetwork::pushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel) {
+		push(std::move(packet), type, toId, channel, id_);
+	}
+
+	void EnetNetwork::pushToSendBuffer(EnetPacket&& packet, PacketType type) {
+		pushToSendBuffer(std::move(packet), type, 0, 0);
+	}
+
+	void EnetNetwork::push(const Packet& packet, PacketType type, int toId, int channel, int fromId) {
+		assert(channel >= 0 && channel < CHANNELS);
+		// Copy buffert to send buffert. Assign the correct sender id.
+		if (packet.size() > 0) {
+			if (toId == 0) {
+				// Send to all, id = 0.
+				sendInternalPacket(InternalPacket(packet, fromId, type, 0, channel));
+				// Send to the local client.
+				pushLocal(InternalPacket(packet, fromId, type, id_));
+			} else if (toId == id_) {
+				// Send to the local client.
+				pushLocal(InternalPacket(packet, fromId, type, toId));
+			} else {
+				// Send to others!
+				sendInternalPacket(InternalPacket(packet, fromId, type, toId, channel));
+			}
+		}
+	}
+
+	void EnetNetwork::push(EnetPacket&& packet, PacketType type, int toId, int channel, int fromId) {
+		assert(channel >= 0 && channel < CHANNELS);
+		if (packet.size() > 0) {
+			if (toId == 0 || toId == id_) {
+				// Local data is never in enet.
+				pushLocal(InternalPacket(Packet(packet.getData(), packet.size()), fromId, type, id_));
+			}
+			if (toId != id_) {
+				InternalPacket iPacket(Packet(), fromId, type, toId, channel);
+				iPacket.eNetPacket_ = std::move(packet);
+				sendInternalPacket(std::move(iPacket));
+			}
+		}
+	}
+
+	int EnetNetwork::pullFromReceiveBuffer(Packet& data) {
+		return pull(data);
+	}
+
+	int EnetNetwork::pullFromReceiveBuffer(EnetPacket& packet) {
+		return pull(packet);
+	}
+
+	int EnetNetwork::pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) {
+		return pullAll(packets);
+	}
+
+	int EnetNetwork::pullAllFromReceiveBuffer(std::vector<std::pair<int, EnetPacket>>& packets) {
+		return pullAll(packets);
+	}
+
+	void EnetNetwork::takeData(InternalPacket& iPacket, Packet& data) {
+		if (iPacket.eNetPacket_.size() > 0) {
+			data = Packet(iPacket.eNetPacket_.getData(), iPacket.eNetPacket_.size());
+			// Release the enet packet now, not when the slot is reused.
+			iPacket.eNetPacket_ = EnetPacket();
+		} else {
+			data = std::move(iPacket.data_);
+		}
+	}
+
+	void EnetNetwork::takeData(InternalPacket& iPacket, EnetPacket& packet) {
+		if (iPacket.eNetPacket_.size() > 0) {
+			packet = std::move(iPacket.eNetPacket_);
+		} else {
+			// Local data was never in enet.
+			packet = EnetPacket(iPacket.data_.size());
+			packet.append(iPacket.data_.getData(), iPacket.data_.size());
+		}
+	}
+
+	template <class T>
+	int EnetNetwork::pull(T& data) {
+		// Pass on the data which did not fit earlier.
+		flushSendOverflow();
+		if (!localPackets_.empty()) {
+			InternalPacket& iPacket = localPackets_.front();
+			takeData(iPacket, data);
+			int id = iPacket.fromId_;
+			localPackets_.pop();
+			return id;
+		}
+		InternalPacket iPacket;
+		while (receivePackets_.pop(iPacket)) {
+			if (iPacket.event_ == RECEIVE_EVENT) {
+				takeData(iPacket, data);
+				return iPacket.fromId_;
+			}
+			handleEvent(iPacket);
+		}
+		return 0;
+	}
+
+	template <class T>
+	int EnetNetwork::pullAll(std::vector<std::pair<int, T>>& packets) {
+		// Pass on the data which did not fit earlier.
+		flushSendOverflow();
+		size_t size = packets.size();
+		while (!localPackets_.empty()) {
+			InternalPacket& iPacket = localPackets_.front();
+			packets.push_back(std::make_pair(iPacket.fromId_, T()));
+			takeData(iPacket, packets.back().second);
+			localPackets_.pop();
+		}
+		receivePackets_.popAll([&](InternalPacket& iPacket) {
+			if (iPacket.event_ == RECEIVE_EVENT) {
+				packets.push_back(std::make_pair(iPacket.fromId_, T()));
+				takeData(iPacket, packets.back().second);
+			} else {
+				handleEvent(iPacket);
+			}
+		});
+		return packets.size() - size;
+	}
+
+	void EnetNetwork::sendInternalPacket(InternalPacket&& iPacket) {
+		// Only data pushed after the call to start() will be sent.
+		if (status_ == NOT_ACTIVE) {
+			return;
+		}
+		if (isNetworkThread()) {
+			// Only the game thread pushes to the send buffer.
+			pushToInbox(std::move(iPacket));
+			return;
+		}
+		flushSendOverflow();
+		// Keep the order, only push directly if nothing is waiting.
+		if (!sendOverflow_.empty() || !sendPackets_.push(std::move(iPacket))) {
+			sendOverflow_.push(std::move(iPacket));
+		}
+		wakeup_.wakeUp();
+	}
+
+	void EnetNetwork::sendInternalPackets(const OutgoingPacket* packets, int count, int fromId) {
+		// The local packets are pushed even when not active, as by pushToSendBuffer(),
+		// sendInternalBatch() skips the others.
+		// The member batch is only used by the game thread.
+		std::vector<InternalPacket> networkBatch;
+		std::vector<InternalPacket>& batch = isNetworkThread() ? networkBatch : batch_;
+		for (int i = 0; i < count; ++i) {
+			const OutgoingPacket& packet = packets[i];
+			if (packet.packet_.size() > 0) {
+				assert(packet.channel_ >= 0 && packet.channel_ < CHANNELS);
+				if (packet.toId_ == 0) {
+					// Send to all, and to yourself.
+					batch.push_back(InternalPacket(packet.packet_, fromId, packet.type_, 0, packet.channel_));
+					pushLocal(InternalPacket(packet.packet_, fromId, packet.type_, id_));
+				} else if (packet.toId_ == id_) {
+					pushLocal(InternalPacket(packet.packet_, fromId, packet.type_, id_));
 				} else {
-					// Send to others!
-					sendPackets_.push(InternalPacket(packet, id_, type, toId));
+					batch.push_back(InternalPacket(packet.packet_, fromId, packet.type_, packet.toId_, packet.channel_));
 				}
 			}
 		}
-		condition_.notify_one();
+
+		sendInternalBatch(batch);
 	}
 
-	void EnetNetwork::pushToSendBuffer(const Packet& packet, PacketType type) {
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			if (packet.size() > 0) {
-				// Send to all, id = 0.
-				sendPackets_.push(InternalPacket(packet, id_, type, 0));
-				// Sent from yourself, id = getId().
-				receivePackets_.push(InternalPacket(packet, id_, type, id_));
+	void EnetNetwork::sendInternalBatch(std::vector<InternalPacket>& batch) {
+		// Only data pushed after the call to start() will be sent.
+		if (status_ == NOT_ACTIVE) {
+			batch.clear();
+			return;
+		}
+		if (isNetworkThread()) {
+			for (InternalPacket& iPacket : batch) {
+				pushToInbox(std::move(iPacket));
 			}
+			batch.clear();
+			return;
+		}
+		flushSendOverflow();
+		// Keep the order, only push directly if nothing is waiting.
+		size_t pushed = sendOverflow_.empty() ? sendPackets_.push(batch.data(), batch.size()) : 0;
+		for (size_t i = pushed; i < batch.size(); ++i) {
+			sendOverflow_.push(std::move(batch[i]));
 		}
-		condition_.notify_one();
+		batch.clear();
+		wakeup_.wakeUp();
 	}
 
-	int EnetNetwork::pullFromReceiveBuffer(Packet& data) {
-		int id;
+	void EnetNetwork::flushSendOverflow() {
+		if (sendOverflow_.empty()) {
+			return;
+		}
+		while (!sendOverflow_.empty() && sendPackets_.push(std::move(sendOverflow_.front()))) {
+			sendOverflow_.pop();
+		}
+		wakeup_.wakeUp();
+	}
+
+	void EnetNetwork::setNetworkThread() {
+		networkThread = true;
+	}
+
+	bool EnetNetwork::isNetworkThread() {
+		return networkThread;
+	}
+
+	void EnetNetwork::pushLocal(InternalPacket&& iPacket) {
+		if (isNetworkThread()) {
+			// Only the game thread uses the local packets.
+			pushToInbox(std::move(iPacket));
+		} else {
+			localPackets_.push(std::move(iPacket));
+		}
+	}
+
+	void EnetNetwork::pushToInbox(InternalPacket&& iPacket) {
 		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			if (receivePackets_.empty()) {
-				return 0;
+			std::lock_guard<std::mutex> lock(inboxMutex_);
+			inbox_.push_back(std::move(iPacket));
+		}
+		wakeup_.wakeUp();
+	}
+
+	void EnetNetwork::takeInbox(std::vector<InternalPacket>& packets) {
+		std::lock_guard<std::mutex> lock(inboxMutex_);
+		packets.swap(inbox_);
+	}
+
+	void EnetNetwork::pushToReceiveBuffer(InternalPacket&& iPacket) {
+		flushReceiveOverflow();
+		// Keep the order, only push directly if nothing is waiting.
+		if (!receiveOverflow_.empty() || !receivePackets_.push(std::move(iPacket))) {
+			receiveOverflow_.push(std::move(iPacket));
+		}
+	}
+
+	void EnetNetwork::flushReceiveOverflow() {
+		while (!receiveOverflow_.empty() && receivePackets_.push(std::move(receiveOverflow_.front()))) {
+			receiveOverflow_.pop();
+		}
+	}
+
+	void EnetNetwork::clearBuffers() {
+		sendPackets_.clear();
+		receivePackets_.clear();
+		receiveOverflow_ = std::queue<InternalPacket>();
+		sendOverflow_ = std::queue<InternalPacket>();
+		localPackets_ = std::queue<InternalPacket>();
+		{
+			std::lock_guard<std::mutex> lock(inboxMutex_);
+			inbox_.clear();
+		}
+		aggregate_ = InternalPacket();
+		aggregateCount_ = 0;
+	}
+
+	struct EnetNetwork::CompressorContext {
+		EnetNetwork* network_;
+		void* rangeCoder_; // Null when lz_ is used.
+		LzCompressor* lz_;
+	};
+
+	void EnetNetwork::setCompression(Compression compression) {
+		compression_ = compression;
+	}
+
+	EnetNetwork::Compression EnetNetwork::getCompression() const {
+		return compression_;
+	}
+
+	void EnetNetwork::setCompressionDictionary(const std::vector<char>& dictionary) {
+		dictionary_ = dictionary;
+	}
+
+	EnetNetwork::CompressionStats EnetNetwork::getCompressionStats() const {
+		CompressionStats stats;
+		stats.sentBytes = sentBytes_.load(std::memory_order_relaxed);
+		stats.sentCompressedBytes = sentCompressedBytes_.load(std::memory_order_relaxed);
+		stats.receivedCompressedBytes = receivedCompressedBytes_.load(std::memory_order_relaxed);
+		stats.receivedBytes = receivedBytes_.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void EnetNetwork::initCompression(ENetHost* host) {
+		sentBytes_ = 0;
+		sentCompressedBytes_ = 0;
+		receivedCompressedBytes_ = 0;
+		receivedBytes_ = 0;
+
+		if (compression_ != NO_COMPRESSION) {
+			CompressorContext* context = new CompressorContext{this, 0, 0};
+			if (compression_ == RANGE_CODER) {
+				context->rangeCoder_ = enet_range_coder_create();
+				if (context->rangeCoder_ == 0) {
+					fprintf(stderr, "An error occured while creating the ENet range coder.\n");
+					delete context;
+					return;
+				}
+			} else {
+				context->lz_ = new LzCompressor(dictionary_);
 			}
+			// Wraps the compressor in order to count the bytes.
+			ENetCompressor compressor;
+			compressor.context = context;
+			compressor.compress = &EnetNetwork::compress;
+			compressor.decompress = &EnetNetwork::decompress;
+			compressor.destroy = &EnetNetwork::destroyCompressor;
+			enet_host_compress(host, &compressor);
+		}
+	}
+
+	size_t ENET_CALLBACK EnetNetwork::compress(void* context, const ENetBuffer* inBuffers, size_t inBufferCount,
+		size_t inLimit, enet_uint8* outData, size_t outLimit) {
+
+		CompressorContext* compressor = static_cast<CompressorContext*>(context);
+		size_t size = compressor->rangeCoder_ != 0
+			? enet_range_coder_compress(compressor->rangeCoder_, inBuffers, inBufferCount, inLimit, outData, outLimit)
+			: compressor->lz_->compress(inBuffers, inBufferCount, inLimit, outData, outLimit);
+		EnetNetwork* network = compressor->network_;
+		network->sentBytes_.fetch_add(inLimit, std::memory_order_relaxed);
+		// Enet sends the datagram uncompressed if the compressed size is not smaller.
+		network->sentCompressedBytes_.fetch_add(size > 0 && size < inLimit ? size : inLimit, std::memory_order_relaxed);
+		return size;
+	}
 
-			InternalPacket& iPacket = receivePackets_.front();
-			data = iPacket.data_;
-			id = iPacket.fromId_;
+	size_t ENET_CALLBACK EnetNetwork::decompress(void* context, const enet_uint8* inData, size_t inLimit,
+		enet_uint8* outData, size_t outLimit) {
 
-			receivePackets_.pop();
+		CompressorContext* compressor = static_cast<CompressorContext*>(context);
+		size_t size = compressor->rangeCoder_ != 0
+			? enet_range_coder_decompress(compressor->rangeCoder_, inData, inLimit, outData, outLimit)
+			: compressor->lz_->decompress(inData, inLimit, outData, outLimit);
+		EnetNetwork* network = compressor->network_;
+		network->receivedCompressedBytes_.fetch_add(inLimit, std::memory_order_relaxed);
+		network->receivedBytes_.fetch_add(size, std::memory_order_relaxed);
+		return size;
+	}
+
+	void ENET_CALLBACK EnetNetwork::destroyCompressor(void* context) {
+		CompressorContext* compressor = static_cast<CompressorContext*>(context);
+		if (compressor->rangeCoder_ != 0) {
+			enet_range_coder_destroy(compressor->rangeCoder_);
 		}
-		condition_.notify_one();
-		return id;
+		delete compressor->lz_;
+		delete compressor;
 	}
 
-	// Sends data packet from/to client.
-	// 0 char type    |
-	// 1 char id      |
-	// 2 char data[N] |
-	ENetPacket* EnetNetwork::createEnetPacket(const Packet& packet, char id, PacketType type) {
-		char data[Packet::MAX_SIZE];
-		unsigned int size = 2 + packet.size();
-		if (size <= Packet::MAX_SIZE) {
-			data[0] = PACKET;
-			data[1] = id;
-			std::copy(packet.getData(), packet.getData() + packet.size(), data + 2);
-		}
-
-		ENetPacket* eNetPacket = 0;
-		if (type == PacketType::RELIABLE) {
-			eNetPacket = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
+	void EnetNetwork::pushReceived(InternalPacket&& iPacket) {
+		if (!iPacket.aggregated_) {
+			pushToReceiveBuffer(std::move(iPacket));
+			return;
+		}
+		forEachAggregated(iPacket.data_.getData(), iPacket.data_.size(), [&](const char* data, int size) {
+			InternalPacket part(Packet(data, size), iPacket.fromId_, iPacket.type_, iPacket.toId_, iPacket.channel_);
+			part.event_ = iPacket.event_;
+			pushToReceiveBuffer(std::move(part));
+		});
+	}
+
+	namespace {
+
+		// Append the data with the size in front.
+		void appendAggregated(Packet& packet, const char* data, int size) {
+			char prefix[5];
+			int bytes = EnetPacket::idSize(size);
+			EnetPacket::writeId(prefix, size, bytes);
+			packet.append(prefix, bytes);
+			packet.append(data, size);
+		}
+
+	}
+
+	void EnetNetwork::queueSendPacket(InternalPacket& iPacket) {
+		int size = iPacket.data_.size();
+		bool small = iPacket.eNetPacket_.size() == 0 && !iPacket.aggregated_
+			&& size > 0 && size <= AGGREGATE_PACKET_SIZE;
+
+		if (aggregateCount_ > 0) {
+			int aggregateSize = aggregate_.data_.size();
+			if (aggregateCount_ == 1) {
+				// The first packet has no size in front yet.
+				aggregateSize += EnetPacket::idSize(aggregateSize);
+			}
+			if (small && aggregate_.fromId_ == iPacket.fromId_ && aggregate_.toId_ == iPacket.toId_
+				&& aggregate_.type_ == iPacket.type_ && aggregate_.channel_ == iPacket.channel_
+				&& aggregateSize + EnetPacket::idSize(size) + size <= AGGREGATE_SIZE) {
+
+				if (aggregateCount_ == 1) {
+					Packet first = std::move(aggregate_.data_);
+					appendAggregated(aggregate_.data_, first.getData(), first.size());
+					aggregate_.aggregated_ = true;
+				}
+				appendAggregated(aggregate_.data_, iPacket.data_.getData(), size);
+				++aggregateCount_;
+				return;
+			}
+			flushAggregate();
+		}
+
+		if (small) {
+			aggregate_ = std::move(iPacket);
+			aggregateCount_ = 1;
 		} else {
-			eNetPacket = enet_packet_create(data, size, ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT);
+			sendPacket(iPacket);
+		}
+	}
+
+	void EnetNetwork::flushAggregate() {
+		if (aggregateCount_ > 0) {
+			aggregateCount_ = 0;
+			sendPacket(aggregate_);
+			aggregate_ = InternalPacket();
+		}
+	}
+
+	// Sends data packet from/to client.
+	// 0   char type    |
+	// 1   char id[M]   |
+	// M+1 char data[N] |
+	ENetPacket* EnetNetwork::createEnetPacket(EnetConnectionType wireType, const char* data, int size,
+		int id, PacketType type, int minIdSize) {
+
+		// Write directly to the enet allocated data.
+		int idSize = std::max(EnetPacket::idSize(id), minIdSize);
+		ENetPacket* eNetPacket = enet_packet_create(0, 1 + idSize + size, getEnetFlags(type));
+		if (eNetPacket != 0) {
+			eNetPacket->data[0] = (char) wireType;
+			EnetPacket::writeId((char*) eNetPacket->data + 1, id, idSize);
+			std::copy(data, data + size, eNetPacket->data + 1 + idSize);
 		}
+		return eNetPacket;
+	}
 
+	ENetPacket* EnetNetwork::createEnetPacket(InternalPacket& iPacket, int id, int minIdSize) {
+		EnetPacket& packet = iPacket.eNetPacket_;
+		EnetConnectionType wireType = iPacket.aggregated_ ? AGGREGATE : PACKET;
+		if (packet.size() == 0) {
+			return createEnetPacket(wireType, iPacket.data_.getData(), iPacket.data_.size(), id, iPacket.type_, minIdSize);
+		}
+		int idSize = packet.headerSize() - 1;
+		if (EnetPacket::idSize(id) > idSize) {
+			// A received packet with a too small header, copy the data.
+			return createEnetPacket(wireType, packet.getData(), packet.size(), id, iPacket.type_);
+		}
+		// Room for the header is already reserved, the id is padded to fill it.
+		ENetPacket* eNetPacket = packet.release();
+		eNetPacket->data[0] = (char) wireType;
+		EnetPacket::writeId((char*) eNetPacket->data + 1, id, idSize);
+		eNetPacket->flags = getEnetFlags(iPacket.type_);
 		return eNetPacket;
 	}
 
+	enet_uint32 EnetNetwork::getEnetFlags(PacketType type) {
+		switch (type) {
+			case PacketType::RELIABLE:
+				return ENET_PACKET_FLAG_RELIABLE;
+			case PacketType::UN_SEQUENCED:
+				return ENET_PACKET_FLAG_UNSEQUENCED;
+			case PacketType::UN_RELIABLE_SEQUENCED:
+				// No flag is a sequenced unreliable packet in enet.
+				return 0;
+			default:
+				return ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+		}
+	}
+
+	enet_uint32 EnetNetwork::getServiceTimeout(ENetHost* host) {
+		enet_uint32 now = enet_time_get();
+		enet_uint32 timeout = IDLE_TIMEOUT;
+		for (ENetPeer* peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+			enet_uint32 time;
+			if (!enet_list_empty(&peer->sentReliableCommands)) {
+				// The oldest command is resent first, a ping is not sent meanwhile.
+				ENetOutgoingCommand* command = (ENetOutgoingCommand*) enet_list_front(&peer->sentReliableCommands);
+				time = command->sentTime + command->roundTripTimeout;
+			} else if (peer->state == ENET_PEER_STATE_CONNECTED) {
+				time = peer->lastReceiveTime + peer->pingInterval;
+			} else {
+				continue;
+			}
+			timeout = std::min(timeout, ENET_TIME_LESS(now, time) ? ENET_TIME_DIFFERENCE(time, now) : 0);
+		}
+		// Enet handles the timer in the next service, without a busy loop.
+		return std::max(timeout, (enet_uint32) 1);
+	}
+
+	Network::PacketType EnetNetwork::getPacketType(enet_uint32 flags) {
+		if (flags & ENET_PACKET_FLAG_RELIABLE) {
+			return PacketType::RELIABLE;
+		}
+		if (flags & ENET_PACKET_FLAG_UNSEQUENCED) {
+			return PacketType::UN_SEQUENCED;
+		}
+		return PacketType::UN_RELIABLE;
+	}
+
 	Network::Status EnetNetwork::getStatus() const {
-		std::lock_guard<std::mutex> lock(mutex_);
 		return status_;
 	}
 
 	int EnetNetwork::getId() const {
-		std::lock_guard<std::mutex> lock(mutex_);
 		return id_;
 	}
 
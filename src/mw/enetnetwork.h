@@ -3,76 +3,345 @@
 
 #include "network.h"
 #include "packet.h"
+#include "enetpacket.h"
+#include "enetwakeup.h"
+#include "spscqueue.h"
 
 #include <enet/enet.h>
 
 #include <queue>
+#include <vector>
+#include <utility>
 #include <mutex>
-#include <condition_variable>
+#include <atomic>
 
 namespace mw {
 
 	// Uses enet for implementing usefull parts of the Network interface.
+	// The push and pull functions must be called from one thread (the game thread)
+	// and do not block on the network thread, the data is passed through lock-free
+	// queues. Data which does not fit in a full send buffer is kept by the game
+	// thread, in order, and passed on by the next push or pull.
 	class EnetNetwork : public Network {
 	public:
+		// Compression of all datagrams sent by enet.
+		enum Compression {
+			NO_COMPRESSION,
+			RANGE_CODER,	// The adaptive range coder in enet, compresses the most.
+			LZ				// Much faster, see LzCompressor.
+		};
+
+		// Bytes of the datagrams sent and received since start(), before and after
+		// compression. Only compressed datagrams are counted when received.
+		struct CompressionStats {
+			unsigned long long sentBytes;
+			unsigned long long sentCompressedBytes;
+			unsigned long long receivedCompressedBytes;
+			unsigned long long receivedBytes;
+		};
+
 		EnetNetwork();
 		virtual ~EnetNetwork();
 
+		// Used from the next call to start(). The server and all clients must use
+		// the same compression, a datagram enet can not decompress is dropped.
+		void setCompression(Compression compression);
+
+		Compression getCompression() const;
+
+		// Used by LZ compression from the next call to start(). The server and all
+		// clients must use the same dictionary, e.g. typical packets.
+		void setCompressionDictionary(const std::vector<char>& dictionary);
+
+		// Safe to call while the network thread is running.
+		CompressionStats getCompressionStats() const;
+
 		void pushToSendBuffer(const Packet& packet, PacketType type, int toId) override final;
 
+		void pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) override final;
+
 		void pushToSendBuffer(const Packet& packet, PacketType type) override final;
 
+		void pushToSendBuffer(const OutgoingPacket* packets, int count) override final;
+
+		// Push data written directly into a enet packet, the data is not copied
+		// and the enet packet is shared by all receivers. The packet is left empty.
+		void pushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel = 0);
+
+		// Same as calling pushToSendBuffer(packet, type, 0).
+		void pushToSendBuffer(EnetPacket&& packet, PacketType type);
+
 		int pullFromReceiveBuffer(Packet& data) override final;
 
+		// Pulls received data without copying it, the packet holds the received
+		// enet packet. Return the sender id, or 0 if there is nothing to pull.
+		int pullFromReceiveBuffer(EnetPacket& packet);
+
+		int pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) override final;
+
+		// Same as above but without copying the data, see pullFromReceiveBuffer(EnetPacket&).
+		int pullAllFromReceiveBuffer(std::vector<std::pair<int, EnetPacket>>& packets);
+
 		int getId() const override final;
 
 		Status getStatus() const override final;
 		
 	protected:
 		enum EnetConnectionType {
-			CONNECT_INFO = 0,
-			PACKET = 1
+			CONNECT_INFO = 0,	// Server to client, the full list of clients.
+			PACKET = 1,
+			JOIN_INFO = 2,		// Server to client, a client is added to the list.
+			LEAVE_INFO = 3,		// Server to client, a client is removed from the list.
+			ROSTER_REQUEST = 4,	// Client to server, asks for a new CONNECT_INFO.
+			AGGREGATE = 5		// Several data packets, each with the size in front.
+		};
+
+		// What a InternalPacket passed between the game thread and the network thread represents.
+		enum Event {
+			RECEIVE_EVENT,			// Packet data to the local client.
+			SERVER_RECEIVE_EVENT,	// Packet data to the server.
+			CONNECT_EVENT,			// A client with id fromId_ is connected.
+			DISCONNECT_EVENT,		// A client with id fromId_ is disconnected.
+			ACCEPT_EVENT,			// The connection for client with id toId_ is accepted.
+			REJECT_EVENT,			// The connection for client with id toId_ is rejected.
+			ROSTER_EVENT			// Between server shards, data_ holds a client list change for client fromId_.
 		};
 
 		class InternalPacket {
 		public:
+			InternalPacket() {
+				fromId_ = 0;
+				type_ = PacketType::RELIABLE;
+				toId_ = 0;
+				channel_ = 0;
+				event_ = RECEIVE_EVENT;
+				aggregated_ = false;
+			}
+
 			InternalPacket(Packet packet, int id, PacketType type) {
-				data_ = packet;
+				data_ = std::move(packet);
 				fromId_ = id;
 				type_ = type;
 				toId_ = 0;
+				channel_ = 0;
+				event_ = RECEIVE_EVENT;
+				aggregated_ = false;
 			}
 
-			InternalPacket(Packet packet, int id, PacketType type, int toId) {
-				data_ = packet;
+			InternalPacket(Packet packet, int id, PacketType type, int toId, int channel = 0) {
+				data_ = std::move(packet);
 				fromId_ = id;
 				type_ = type;
 				toId_ = toId;
+				channel_ = channel;
+				event_ = RECEIVE_EVENT;
+				aggregated_ = false;
+			}
+
+			InternalPacket(Event event, int id, int toId) {
+				fromId_ = id;
+				type_ = PacketType::RELIABLE;
+				toId_ = toId;
+				channel_ = 0;
+				event_ = event;
+				aggregated_ = false;
 			}
 
 			Packet data_;
+			EnetPacket eNetPacket_; // Used instead of data_ when the data is stored directly in enet.
 			int fromId_;
 			PacketType type_;
 			int toId_;
+			int channel_; // The enet channel the data is sent on.
+			Event event_;
+			bool aggregated_; // The data holds several packets, see queueSendPacket().
 		};
 
+		// The longest time in milliseconds the network thread blocks waiting
+		// for data, used when no enet timer is running, e.g. without peers.
+		static const enet_uint32 IDLE_TIMEOUT = 1000;
+
+		// The maximum number of packets in the send buffer and in the receive buffer.
+		static const size_t BUFFER_CAPACITY = 1024;
+
+		// Data up to AGGREGATE_PACKET_SIZE bytes is sent together with other data,
+		// in one enet packet of up to AGGREGATE_SIZE bytes of data.
+		static const int AGGREGATE_PACKET_SIZE = 128;
+		static const int AGGREGATE_SIZE = 1024;
+
 		virtual InternalPacket receive(ENetEvent eNetEvent) = 0;
 
+		// Called by the game thread in pullFromReceiveBuffer() for all pulled
+		// packets which are not a RECEIVE_EVENT.
+		virtual void handleEvent(const InternalPacket& /*iPacket*/) {
+		}
+
 		// Sends data packet from client width the corresponding id.
-		// 0 char type    |	EnetNetwork type.
-		// 1 char id      |
-		// 2 char data[N] |
-		static ENetPacket* createEnetPacket(const Packet& dataPacket, char fromId, PacketType type);
+		// 0   char type    |	EnetNetwork type, PACKET or AGGREGATE.
+		// 1   char id[M]   |	1 to 5 bytes, see EnetPacket.
+		// M+1 char data[N] |
+		// The id is padded to at least minIdSize bytes.
+		static ENetPacket* createEnetPacket(EnetConnectionType wireType, const char* data, int size,
+			int id, PacketType type, int minIdSize = 1);
+
+		// Return the enet packet, with the header written, for the data in the internal packet.
+		// Uses the enet packet in iPacket.eNetPacket_ if there is one and the id fits in
+		// its header, else the data is copied.
+		static ENetPacket* createEnetPacket(InternalPacket& iPacket, int id, int minIdSize = 1);
+
+		static enet_uint32 getEnetFlags(PacketType type);
+
+		// Return the time in milliseconds until enet needs to be serviced, i.e.
+		// the next resend of a reliable command or the next ping of a peer.
+		// At most IDLE_TIMEOUT.
+		static enet_uint32 getServiceTimeout(ENetHost* host);
 
-		std::queue<InternalPacket> sendPackets_;
-		std::queue<InternalPacket> receivePackets_;
+		// Return the type of a received enet packet with the flags. Small
+		// UN_RELIABLE and UN_RELIABLE_SEQUENCED packets are the same on the
+		// wire and are both returned as UN_RELIABLE.
+		static PacketType getPacketType(enet_uint32 flags);
 
-		int id_;
-		Status status_;
+		// Called by the game thread or a network thread. Push the data, sent from
+		// fromId, to the client toId, or to all clients and the local client if
+		// toId is 0. Used by all push functions, the client and the server only
+		// push from different ids.
+		void push(const Packet& packet, PacketType type, int toId, int channel, int fromId);
+
+		// Same as above, the enet packet is sent as it is and left empty.
+		void push(EnetPacket&& packet, PacketType type, int toId, int channel, int fromId);
+
+		// Called by the game thread. Push the packet to the network thread.
+		void sendInternalPacket(InternalPacket&& iPacket);
+
+		// Called by the game thread. Push all packets, sent from fromId, to the
+		// network thread at once. The network thread then sends all of them
+		// before flushing, so enet puts them in as few datagrams as possible.
+		void sendInternalPackets(const OutgoingPacket* packets, int count, int fromId);
+
+		// Called by the game thread. Push all packets in the batch to the network
+		// thread at once, the batch is left empty.
+		void sendInternalBatch(std::vector<InternalPacket>& batch);
+
+		// Called by the game thread. Move kept packets to the send buffer.
+		void flushSendOverflow();
+
+		// Called by the network thread first. The push functions, when called by a
+		// network thread, e.g. from a ServerInterface callback, then pass the data
+		// through the inbox instead of the buffers only used by the game thread.
+		static void setNetworkThread();
+
+		// Return true if called by the network thread of any EnetNetwork.
+		static bool isNetworkThread();
+
+		// Called by the game thread or a network thread. Push the packet to the local client.
+		void pushLocal(InternalPacket&& iPacket);
+
+		// Called by any network thread. Pass the packet to the network thread of this
+		// network, which takes it with takeInbox(). A packet to the local client
+		// (toId_ == id_) is pushed to the receive buffer, others are sent.
+		void pushToInbox(InternalPacket&& iPacket);
+
+		// Called by the network thread. Move all packets in the inbox to the empty vector.
+		void takeInbox(std::vector<InternalPacket>& packets);
+
+		// Called by the network thread. Push the packet to the game thread,
+		// packets which do not fit in the receive buffer are kept in order until there is space.
+		void pushToReceiveBuffer(InternalPacket&& iPacket);
+
+		// Called by the network thread. Move kept packets to the receive buffer.
+		void flushReceiveOverflow();
+
+		// Called by the network thread. Push the received packet to the game thread,
+		// an aggregated packet is split into its packets.
+		void pushReceived(InternalPacket&& iPacket);
+
+		// Call function(const char* data, int size) for each packet in the aggregated
+		// data. The size of each packet is stored in front of it, in the same way as an
+		// id. Return false if the data is not valid, packets before the error are passed on.
+		template <class Function>
+		static bool forEachAggregated(const char* data, int size, Function function) {
+			int index = 0;
+			while (index < size) {
+				int packetSize;
+				int bytes = EnetPacket::readId(data + index, size - index, packetSize);
+				if (bytes == 0 || packetSize <= 0 || packetSize > size - index - bytes) {
+					return false;
+				}
+				index += bytes;
+				function(data + index, packetSize);
+				index += packetSize;
+			}
+			return true;
+		}
+
+		// Called by the network thread. Send the packet to its receivers.
+		virtual void sendPacket(InternalPacket& iPacket) = 0;
+
+		// Called by the network thread. Send the packet with sendPacket(). Small
+		// packets following each other, with the same sender, receiver, type and
+		// channel, are held back and sent together as one AGGREGATE packet, in
+		// order to save the per packet overhead in enet. The held back packets are
+		// sent when a packet which does not fit arrives or by flushAggregate().
+		void queueSendPacket(InternalPacket& iPacket);
+
+		// Called by the network thread. Send the held back packets.
+		void flushAggregate();
+
+		// Called by start() when the network thread is not running.
+		void clearBuffers();
+
+		// Called by start() after the host is created. Use the compression for
+		// the host and reset the compression stats.
+		void initCompression(ENetHost* host);
+
+		SpscQueue<InternalPacket> sendPackets_; // Game thread -> network thread.
+		SpscQueue<InternalPacket> receivePackets_; // Network thread -> game thread.
+		std::queue<InternalPacket> receiveOverflow_; // Only used by the network thread.
+		std::queue<InternalPacket> sendOverflow_; // Only used by the game thread.
+		std::queue<InternalPacket> localPackets_; // Sent to itself, only used by the game thread.
+		std::vector<InternalPacket> batch_; // Only used by the game thread in sendInternalPackets.
+		std::mutex inboxMutex_;
+		std::vector<InternalPacket> inbox_; // Pushed by network threads, guarded by inboxMutex_.
+		InternalPacket aggregate_; // Held back packets, only used by the network thread.
+		int aggregateCount_;
+
+		std::atomic<int> id_;
+		std::atomic<Status> status_;
 		mutable std::mutex mutex_;
-		std::condition_variable condition_;
+		EnetWakeup wakeup_; // Wakes up the network thread when there is data to send.
+
+		static int nbrOfInstances; // Number of existing instances, enet is initialized while > 0.
+
+	private:
+		struct CompressorContext;
+
+		// Move the received data in the internal packet to data, copy it if
+		// the type of data does not match.
+		static void takeData(InternalPacket& iPacket, Packet& data);
+		static void takeData(InternalPacket& iPacket, EnetPacket& packet);
+
+		// Called by the game thread. Used by the pull functions for both Packet and EnetPacket.
+		template <class T>
+		int pull(T& data);
+
+		template <class T>
+		int pullAll(std::vector<std::pair<int, T>>& packets);
+
+		static size_t ENET_CALLBACK compress(void* context, const ENetBuffer* inBuffers, size_t inBufferCount,
+			size_t inLimit, enet_uint8* outData, size_t outLimit);
+
+		static size_t ENET_CALLBACK decompress(void* context, const enet_uint8* inData, size_t inLimit,
+			enet_uint8* outData, size_t outLimit);
+
+		static void ENET_CALLBACK destroyCompressor(void* context);
 
-		static int nbrOfInstances;
+		Compression compression_;
+		std::vector<char> dictionary_;
+		// Written by the network thread, in the enet compressor.
+		std::atomic<unsigned long long> sentBytes_;
+		std::atomic<unsigned long long> sentCompressedBytes_;
+		std::atomic<unsigned long long> receivedCompressedBytes_;
+		std::atomic<unsigned long long> receivedBytes_;
 	};
 
 } // Namespace mw.
@@ -0,0 +1,136 @@
+#include "enetpacket.h"
+
+#include <algorithm>
+
+namespace mw {
+
+	int EnetPacket::idSize(int id) {
+		unsigned int value = id;
+		int size = 1;
+		while (value >= 0x80) {
+			value >>= 7;
+			++size;
+		}
+		return size;
+	}
+
+	void EnetPacket::writeId(char* data, int id, int size) {
+		unsigned int value = id;
+		for (int i = 0; i < size - 1; ++i) {
+			data[i] = (char) (0x80 | (value & 0x7F));
+			value >>= 7;
+		}
+		data[size - 1] = (char) value;
+	}
+
+	int EnetPacket::readId(const char* data, int size, int& id) {
+		unsigned int value = 0;
+		// An int never needs more than 5 bytes.
+		for (int i = 0; i < size && i < 5; ++i) {
+			unsigned int byte = (unsigned char) data[i];
+			value |= (byte & 0x7F) << 7 * i;
+			if ((byte & 0x80) == 0) {
+				id = value;
+				return i + 1;
+			}
+		}
+		return 0;
+	}
+
+	EnetPacket::EnetPacket() : packet_(0), headerSize_(HEADER_SIZE), index_(0), size_(0), fail_(false) {
+	}
+
+	EnetPacket::EnetPacket(int capacity) : packet_(0), headerSize_(HEADER_SIZE), index_(0), size_(0), fail_(false) {
+		if (!reserve(capacity)) {
+			fail_ = true;
+		}
+	}
+
+	EnetPacket::EnetPacket(ENetPacket* packet) : packet_(packet), headerSize_(HEADER_SIZE), index_(0), size_(0), fail_(false) {
+		int id;
+		int idSize;
+		if (packet_ != 0 && packet_->dataLength > 1
+			&& (idSize = readId((const char*) packet_->data + 1, (int) packet_->dataLength - 1, id)) > 0) {
+			headerSize_ = 1 + idSize;
+			size_ = (int) packet_->dataLength - headerSize_;
+		}
+	}
+
+	EnetPacket::~EnetPacket() {
+		if (packet_ != 0) {
+			enet_packet_destroy(packet_);
+		}
+	}
+
+	EnetPacket::EnetPacket(EnetPacket&& packet) : packet_(packet.packet_), headerSize_(packet.headerSize_),
+		index_(packet.index_), size_(packet.size_), fail_(packet.fail_) {
+		packet.packet_ = 0;
+		packet.headerSize_ = HEADER_SIZE;
+		packet.index_ = 0;
+		packet.size_ = 0;
+		packet.fail_ = false;
+	}
+
+	EnetPacket& EnetPacket::operator=(EnetPacket&& packet) {
+		if (this != &packet) {
+			std::swap(packet_, packet.packet_);
+			std::swap(headerSize_, packet.headerSize_);
+			std::swap(index_, packet.index_);
+			std::swap(size_, packet.size_);
+			std::swap(fail_, packet.fail_);
+		}
+		return *this;
+	}
+
+	void EnetPacket::append(const char* data, int size) {
+		if (size <= 0) {
+			return;
+		}
+		if (reserve(size_ + size)) {
+			std::copy(data, data + size, (char*) packet_->data + headerSize_ + size_);
+			size_ += size;
+		} else {
+			fail_ = true;
+		}
+	}
+
+	bool EnetPacket::reserve(int size) {
+		if (size > (int) Packet::MAX_SIZE) {
+			return false;
+		}
+		size_t length = headerSize_ + size;
+		if (packet_ == 0) {
+			// The flags are set when the packet is sent.
+			packet_ = enet_packet_create(0, std::max(length, HEADER_SIZE + Packet::INLINE_SIZE), 0);
+			return packet_ != 0;
+		}
+		if (length <= packet_->dataLength) {
+			return true;
+		}
+		// Grow at least twice the size, enet copies the data to the new buffer.
+		length = std::min(std::max(length, 2 * packet_->dataLength), headerSize_ + Packet::MAX_SIZE);
+		return enet_packet_resize(packet_, length) == 0;
+	}
+
+	const char* EnetPacket::getData() const {
+		if (packet_ == 0) {
+			return 0;
+		}
+		return (const char*) packet_->data + headerSize_;
+	}
+
+	ENetPacket* EnetPacket::release() {
+		ENetPacket* packet = packet_;
+		if (packet != 0) {
+			// Only shrinks the length, the data is untouched.
+			enet_packet_resize(packet, headerSize_ + size_);
+		}
+		packet_ = 0;
+		headerSize_ = HEADER_SIZE;
+		index_ = 0;
+		size_ = 0;
+		fail_ = false;
+		return packet;
+	}
+
+} // Namespace mw.
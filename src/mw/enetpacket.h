@@ -0,0 +1,137 @@
+#ifndef MW_ENETPACKET_H
+#define MW_ENETPACKET_H
+
+#include "packet.h"
+
+#include <enet/enet.h>
+
+namespace mw {
+
+	// Data stored directly in a enet owned buffer. Room for the EnetNetwork
+	// header is reserved in front of the data, so the buffer is handed over to
+	// enet without any copy, and one enet packet is shared by all receivers.
+	// The enet packet is allocated on the first write and is bounded by
+	// Packet::MAX_SIZE in the same way as a Packet.
+	// Can also be pulled from a EnetNetwork, it then holds the received enet
+	// packet, which is destroyed with the EnetPacket.
+	//
+	// The EnetNetwork header is a type byte followed by an id. The id is stored
+	// with 7 bits per byte, least significant bits first, and the high bit set
+	// on all bytes but the last. Small ids only take one byte, and an id can be
+	// padded with extra bytes to fill reserved room.
+	class EnetPacket {
+	public:
+		// Bytes reserved in front of the data for the id.
+		static const int MAX_ID_SIZE = 3;
+
+		// Largest id which fits in the reserved room.
+		static const int MAX_ID = (1 << 7 * MAX_ID_SIZE) - 1;
+
+		// Bytes reserved in front of the data for the EnetNetwork header.
+		static const int HEADER_SIZE = 1 + MAX_ID_SIZE;
+
+		// Return the number of bytes needed to store the id.
+		static int idSize(int id);
+
+		// Write the id using exactly size bytes, size must be at least idSize(id).
+		static void writeId(char* data, int id, int size);
+
+		// Read an id from at most size bytes. Return the number of bytes read,
+		// or 0 if the data is not a valid id.
+		static int readId(const char* data, int size, int& id);
+
+		EnetPacket();
+
+		// Reserve room for capacity bytes of data.
+		explicit EnetPacket(int capacity);
+
+		// Take ownership of a enet packet which already has the header in front
+		// of the data, i.e. a packet received from another EnetNetwork. The
+		// packet holds no data if the header is not valid.
+		explicit EnetPacket(ENetPacket* packet);
+
+		~EnetPacket();
+
+		EnetPacket(EnetPacket&& packet);
+		EnetPacket& operator=(EnetPacket&& packet);
+
+		EnetPacket(const EnetPacket&) = delete;
+		EnetPacket& operator=(const EnetPacket&) = delete;
+
+		EnetPacket& operator<<(char byte) {
+			push_back(byte);
+			return *this;
+		}
+
+		EnetPacket& operator<<(const Packet& packet) {
+			append(packet.getData(), packet.size());
+			return *this;
+		}
+
+		EnetPacket& operator>>(char& byte) {
+			if (index_ < size_) {
+				byte = getData()[index_++];
+			} else {
+				byte = 0;
+				fail_ = true;
+			}
+			return *this;
+		}
+
+		char operator[](int index) const {
+			return getData()[index];
+		}
+
+		unsigned int dataLeftToRead() const {
+			return size_ - index_;
+		}
+
+		inline void push_back(char byte) {
+			if (packet_ != 0 && headerSize_ + size_ < (int) packet_->dataLength) {
+				packet_->data[headerSize_ + size_++] = byte;
+			} else {
+				append(&byte, 1);
+			}
+		}
+
+		// Append size bytes of data to the end of the packet.
+		void append(const char* data, int size);
+
+		// Make the packet able to hold size bytes of data without reallocation.
+		// Return false if size is larger than Packet::MAX_SIZE.
+		bool reserve(int size);
+
+		// Return the data, not including the header. Null if nothing is written.
+		const char* getData() const;
+
+		int size() const {
+			return size_;
+		}
+
+		// Return true if a write or read has been out of bounds.
+		bool fail() const {
+			return fail_;
+		}
+
+		// Return the size of the header room in front of the data. HEADER_SIZE
+		// for written packets, the size of the received header for received packets.
+		int headerSize() const {
+			return headerSize_;
+		}
+
+		// Return the enet packet, with the header room in front of the data,
+		// and leave this packet empty. The caller owns the returned packet.
+		// Return null if nothing is written.
+		ENetPacket* release();
+
+	private:
+		ENetPacket* packet_;
+		int headerSize_;
+		int index_;
+		int size_;
+		bool fail_;
+	};
+
+} // Namespace mw.
+
+#endif // MW_ENETPACKET_H
@@ -1,21 +1,54 @@
 #include "enetserver.h"
 
 #include <vector>
+#include <algorithm>
 #include <iostream>
+#include <cstdint>
+#include <cassert>
 
 namespace mw {
 
-	EnetServer::EnetServer(int port, ServerInterface& serverInterface) : serverInterface_(serverInterface) {
+	namespace {
+
+		void setPeerId(ENetPeer* peer, int id) {
+			peer->data = reinterpret_cast<void*>(static_cast<intptr_t>(id));
+		}
+
+		// Return 0 if no id is assigned.
+		int getPeerId(const ENetPeer* peer) {
+			return static_cast<int>(reinterpret_cast<intptr_t>(peer->data));
+		}
+
+		// Append the id stored as in the EnetNetwork header.
+		void appendId(std::vector<char>& data, int id) {
+			int size = EnetPacket::idSize(id);
+			data.resize(data.size() + size);
+			EnetPacket::writeId(data.data() + data.size() - size, id, size);
+		}
+
+	}
+
+	EnetServer::EnetServer(int port, ServerInterface& serverInterface, Dispatch dispatch, int maxPeers)
+		: EnetServer(port, serverInterface, dispatch, maxPeers, std::make_shared<ShardGroup>(), 0) {
+
+		group_->shards_.push_back(this);
+	}
+
+	EnetServer::EnetServer(int port, ServerInterface& serverInterface, Dispatch dispatch, int maxPeers,
+		const std::shared_ptr<ShardGroup>& group, int shard)
+		: maxPeers_(std::min(std::max(maxPeers, 1), (int) ENET_PROTOCOL_MAXIMUM_PEER_ID)),
+		serverInterface_(serverInterface), dispatch_(dispatch), group_(group), shard_(shard) {
 		status_ = NOT_ACTIVE;
 
 		address_.host = ENET_HOST_ANY;
 		address_.port = port;
+		server_ = 0;
 
 		// Garanties that the server always has the correct id.
 		id_ = Network::SERVER_ID + 1;
 
-		// The id to be assigned to the next connected client.
-		currentId_ = id_ + 1;
+		// The last assigned id, the next connected client gets the next id.
+		currentId_ = id_ + 1 + shard_;
 	}
 
 	EnetServer::~EnetServer() {
@@ -27,177 +60,186 @@ namespace mw {
 		for (auto& pair : peers_) {
 			enet_peer_reset(pair.first);
 		}
-		if (server_ != 0) {
+		if (server_ != 0 && group_->hosts_ == 0) {
 			enet_host_destroy(server_);
 		}
 	}
 
 	void EnetServer::serverPushToSendBuffer(const Packet& packet, PacketType type, int toId) {
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			// Copy buffert to send buffert. Assign the correct sender id.
-			if (packet.size() > 0) {
-				if (toId == 0) {
-					pushToSendBuffer(packet, type);
-				} else {
-					// Send to others!
-					sendPackets_.push(InternalPacket(packet, SERVER_ID, type, toId));
-				}
-			}
-		}
-		condition_.notify_one();
+		serverPushToSendBuffer(packet, type, toId, 0);
+	}
+
+	void EnetServer::serverPushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) {
+		push(packet, type, toId, channel, SERVER_ID);
 	}
 
 	void EnetServer::serverPushToSendBuffer(const Packet& packet, PacketType type) {
-		{
-			std::lock_guard<std::mutex> lock(mutex_);
-			if (packet.size() > 0) {
-				// Send to all, id = 0.
-				sendPackets_.push(InternalPacket(packet, SERVER_ID, type, 0));
-				// Send to local client.
-				receivePackets_.push(InternalPacket(packet, SERVER_ID, type, id_));
-			}
-		}
-		condition_.notify_one();
+		serverPushToSendBuffer(packet, type, 0, 0);
+	}
+
+	void EnetServer::serverPushToSendBuffer(const OutgoingPacket* packets, int count) {
+		sendInternalPackets(packets, count, SERVER_ID);
+	}
+
+	void EnetServer::serverPushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel) {
+		push(std::move(packet), type, toId, channel, SERVER_ID);
+	}
+
+	void EnetServer::serverPushToSendBuffer(EnetPacket&& packet, PacketType type) {
+		serverPushToSendBuffer(std::move(packet), type, 0, 0);
 	}
 
 	void EnetServer::start() {
 		std::lock_guard<std::mutex> lock(mutex_);
 		if (status_ == NOT_ACTIVE) {
-			status_ = ACTIVE;
-			// Remove old packet.
-			while (!sendPackets_.empty()) {
-				sendPackets_.pop();
-			}
-			while (!receivePackets_.empty()) {
-				receivePackets_.pop();
+			// The previous network thread is finished when the status is not active.
+			if (thread_.joinable()) {
+				thread_.join();
 			}
 
-			// Create a host.
-			server_ = enet_host_create(&address_, 32, 2, 0, 0);
-			if (server_ == NULL) {
+			// Create a host using enet_host_create.
+			ENetHost* host = enet_host_create(&address_, maxPeers_, CHANNELS, 0, 0);
+			if (host == NULL) {
 				fprintf(stderr, "An error occured while trying to create an ENet server host\n");
 				exit(EXIT_FAILURE);
 			}
-
-			thread_ = std::thread(&EnetServer::update, this);
+			{
+				// A server on its own, the client list starts over.
+				std::lock_guard<std::mutex> groupLock(group_->mutex_);
+				group_->runningShards_ = 1;
+				group_->roster_.clear();
+				group_->rosterVersion_ = 0;
+			}
+			startThread(host);
 		}
 	}
 
+	void EnetServer::startShard(ENetHost* host) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		assert(status_ == NOT_ACTIVE && !thread_.joinable());
+		startThread(host);
+	}
+
+	void EnetServer::startThread(ENetHost* host) {
+		status_ = ACTIVE;
+		// Remove old packet.
+		clearBuffers();
+		acceptedIds_.clear();
+		peers_.clear();
+		peerIndexes_.clear();
+		pendingPeers_.clear();
+		relayed_.clear();
+
+		server_ = host;
+		initCompression(server_);
+
+		thread_ = std::thread(&EnetServer::update, this);
+	}
+
 	void EnetServer::stop() {
 		{
 			std::lock_guard<std::mutex> lock(mutex_);
-			if (status_ == ACTIVE) {
-				status_ = DISCONNECTING;
-				for (auto it = peers_.begin(); it != peers_.end(); ++it) {
-					ENetPeer* peer = it->first;
-					enet_peer_disconnect(peer, 0);
-				}
-			}
+			// The network thread disconnects the peers. Compare, in order to not
+			// overwrite the network thread setting the status to not active.
+			Status active = ACTIVE;
+			status_.compare_exchange_strong(active, DISCONNECTING);
 		}
-		condition_.notify_one();
+		wakeup_.wakeUp();
 	}
 
 	void EnetServer::update() {
-		mutex_.lock();
+		setNetworkThread();
+		wakeup_.setHost(server_);
+		// Enet is only used by the network thread.
+		bool disconnecting = false;
 		while (status_ != NOT_ACTIVE) {
+			if (!disconnecting && status_ == DISCONNECTING) {
+				disconnecting = true;
+				for (auto& pair : peers_) {
+					enet_peer_disconnect(pair.first, 0);
+				}
+				for (auto& pair : pendingPeers_) {
+					enet_peer_disconnect(pair.second, 0);
+				}
+			}
+
 			ENetEvent eNetEvent;
-			int eventStatus = 0;
-			while (status_ != NOT_ACTIVE &&
-				(eventStatus = enet_host_service(server_, &eNetEvent, 0)) > 0) {
+			while (enet_host_service(server_, &eNetEvent, 0) > 0) {
 				switch (eNetEvent.type) {
 					case ENET_EVENT_TYPE_CONNECT:
 						//printf("(Server) We got a new connection from %x\n",eNetEvent.peer->address.host);
-						if (status_ != DISCONNECTING) {
+						if (!disconnecting) {
 							// Signal the client that a new client is connected!
 							// Is the connection accepted?
-							int tmpId_ = currentId_ + 1;
-							++currentId_;
-							// Already own the mutex.
-							std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
-							condition_.wait(lock);
-							if (serverInterface_.connectToServer(tmpId_)) {
-								// Assign id to client and set the next id to an uniqe value.
-								Pair pair(eNetEvent.peer, tmpId_);
-								peers_.push_back(pair);
-
-								// Send info about the new client to everybody.
-								sendConnectInfoToPeers(peers_);
+							int tmpId_ = nextId();
+							setPeerId(eNetEvent.peer, tmpId_);
+							if (dispatch_ == NETWORK_THREAD) {
+								if (serverInterface_.connectToServer(tmpId_)) {
+									acceptPeer(eNetEvent.peer, tmpId_);
+								} else {
+									enet_peer_disconnect(eNetEvent.peer, 0);
+								}
 							} else {
-								enet_peer_disconnect(eNetEvent.peer, 0);
+								// Let the game thread decide.
+								pendingPeers_[tmpId_] = eNetEvent.peer;
+								pushToReceiveBuffer(InternalPacket(CONNECT_EVENT, tmpId_, SERVER_ID));
 							}
-							// To keep the mutex locked!
-							lock.release();
 						} else {
 							// Stops new connections to be made.
 							enet_peer_disconnect(eNetEvent.peer, 0);
 						}
 						break;
 					case ENET_EVENT_TYPE_RECEIVE:
-						if (status_ != NOT_ACTIVE) {
-							InternalPacket iPacket = receive(eNetEvent);
-							
-							// No data to receive?
-							if (iPacket.data_.size()) {
-								// Already own the mutex.
-								std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
-								condition_.wait(lock);
-								// Sent to who?
-								if (iPacket.toId_ == SERVER_ID) { // To server?
-									serverInterface_.receiveToServer(iPacket.data_, iPacket.fromId_);
-								} else if (iPacket.toId_ != 0) { // Sent to a specific client?
-									if (iPacket.toId_ == id_) { // Sent to local client.
-										receivePackets_.push(iPacket);
-									} else { // Sent to Remote client
-										sendPackets_.push(iPacket);
-									}									
-								} else { // Sent to all!
-									receivePackets_.push(iPacket);
-									sendPackets_.push(iPacket);
+					{
+						InternalPacket iPacket = receive(eNetEvent);
+						// Data to relay or to the local client takes the enet packet.
+						bool taken = iPacket.eNetPacket_.size() > 0;
+
+						// No data to receive?
+						if (iPacket.data_.size() > 0 || taken) {
+							// Sent to who?
+							if (iPacket.toId_ == SERVER_ID) { // To server?
+								if (dispatch_ == NETWORK_THREAD) {
+									if (iPacket.aggregated_) {
+										int fromId = iPacket.fromId_;
+										forEachAggregated(iPacket.data_.getData(), iPacket.data_.size(), [&](const char* data, int size) {
+											serverInterface_.receiveToServer(Packet(data, size), fromId);
+										});
+									} else {
+										serverInterface_.receiveToServer(iPacket.data_, iPacket.fromId_);
+									}
+								} else {
+									iPacket.event_ = SERVER_RECEIVE_EVENT;
+									pushReceived(std::move(iPacket));
+								}
+							} else if (iPacket.toId_ != 0) { // Sent to a specific client?
+								if (iPacket.toId_ == id_) { // Sent to local client.
+									pushReceived(std::move(iPacket));
+								} else if (getShard(iPacket.toId_) != shard_) { // Connected to another shard.
+									relayToShard(getShard(iPacket.toId_), iPacket);
+								} else { // Sent to Remote client, relay directly.
+									sendToPeers(iPacket);
 								}
-								// To keep the mutex locked!
-								lock.release();
+							} else { // Sent to all!
+								for (int shard = 0; shard < (int) group_->shards_.size(); ++shard) {
+									if (shard != shard_) {
+										relayToShard(shard, iPacket);
+									}
+								}
+								// Aggregated data is relayed as it is.
+								sendToPeers(iPacket);
+								pushReceived(std::move(iPacket));
 							}
 						}
-						enet_packet_destroy(eNetEvent.packet);
+						if (!taken) {
+							enet_packet_destroy(eNetEvent.packet);
+						}
+					}
 						break;
 					case ENET_EVENT_TYPE_DISCONNECT:
-					{
-						printf("%s disconnected.\n", (char*) eNetEvent.peer->data);
-						// Reset client's information
-						auto it = peers_.begin();
-						for (; it != peers_.end(); ++it) {
-							if (it->first == eNetEvent.peer) {
-								break;
-							}
-						}
-
-						// Remove the connection if its old (i.e. it is in the vector
-						// and not a turned down connection).
-						if (it != peers_.end()) {
-							InternalPacket iPacket(Packet(), it->second, PacketType::RELIABLE);
-							// Already own the mutex.
-							std::unique_lock<std::mutex> lock(mutex_, std::adopt_lock);
-							condition_.wait(lock);
-							// Signal the server that a client is disconnecting.
-							serverInterface_.disconnectToServer(iPacket.fromId_);
-							lock.release();
-							// Remove peer from vector.
-							std::swap(*it, peers_.back());
-							peers_.pop_back();
-
-							// Send the updated client list to all clients.
-							sendConnectInfoToPeers(peers_);
-						}
-
-						// When all peers is disconnected, then clean up.
-						if (status_ == DISCONNECTING && peers_.size() == 0) {
-							eNetEvent.peer->data = NULL;
-							status_ = NOT_ACTIVE;
-						}
-
+						//printf("(Server) %d disconnected.\n", getPeerId(eNetEvent.peer));
+						disconnectPeer(eNetEvent.peer);
 						eNetEvent.peer->data = NULL;
-					}
 						break;
 					case ENET_EVENT_TYPE_NONE:
 						break;
@@ -205,102 +247,368 @@ namespace mw {
 			}
 
 			// Send all packets in send buffer to all clients.
-			while (status_ != NOT_ACTIVE && !sendPackets_.empty()) {
-				InternalPacket& iPacket = sendPackets_.front();
-
-				// Data to send? And data through the filter is allowed to be sent?
-				if (iPacket.data_.size() > 0) {
-					// Send the packet to the peer over channel id 0.
-					// enet handles the cleen up of eNetPacket;
-					for (auto it = peers_.begin(); it != peers_.end(); ++it) {
-						int id = it->second;
-						// Send to all?
-						if (iPacket.toId_ == 0) {
-							// The sender?
-							if (iPacket.fromId_ == id) {
-								// Skip to return data to the sender.
-								continue;
+			InternalPacket iPacket;
+			while (sendPackets_.pop(iPacket)) {
+				if (iPacket.event_ != RECEIVE_EVENT) {
+					// Send held back packets before the peers change.
+					flushAggregate();
+				}
+				switch (iPacket.event_) {
+					case ACCEPT_EVENT:
+					{
+						// Accepted by the game thread, if still connected.
+						auto it = pendingPeers_.find(iPacket.toId_);
+						if (it != pendingPeers_.end()) {
+							ENetPeer* peer = it->second;
+							pendingPeers_.erase(it);
+							if (disconnecting) {
+								enet_peer_disconnect(peer, 0);
+							} else {
+								acceptPeer(peer, iPacket.toId_);
 							}
-							ENetPacket* eNetPacket = createEnetPacket(iPacket.data_, iPacket.fromId_, iPacket.type_);
-							ENetPeer* peer = it->first;
-							enet_peer_send(peer, 0, eNetPacket);
-						} else if (id == iPacket.toId_) { // Send to the specific client?
-							ENetPacket* eNetPacket = createEnetPacket(iPacket.data_, iPacket.fromId_, iPacket.type_);
-							ENetPeer* peer = it->first;
-							enet_peer_send(peer, 0, eNetPacket);
-							// Only send to one client.
-							break;
 						}
 					}
+						break;
+					case REJECT_EVENT:
+					{
+						auto it = pendingPeers_.find(iPacket.toId_);
+						if (it != pendingPeers_.end()) {
+							enet_peer_disconnect(it->second, 0);
+							pendingPeers_.erase(it);
+						}
+					}
+						break;
+					default:
+						queueSendPacket(iPacket);
+						break;
 				}
-
-				sendPackets_.pop();
 			}
+			sendRelayed();
+			flushAggregate();
+
+			// Give the game thread the packets which did not fit earlier.
+			flushReceiveOverflow();
 
 			enet_host_flush(server_);
 
-			// The server is not active? Or the disconnection is finish?
-			if (status_ == NOT_ACTIVE || (status_ == DISCONNECTING && peers_.size() == 0)) {
-				enet_host_destroy(server_);
+			// The disconnection is finish?
+			if (disconnecting && peers_.empty() && pendingPeers_.empty()) {
+				wakeup_.setHost(0);
+				{
+					std::lock_guard<std::mutex> lock(group_->mutex_);
+					--group_->runningShards_;
+					if (group_->hosts_ == 0) {
+						enet_host_destroy(server_);
+					} else if (group_->runningShards_ == 0) {
+						// The last shard to stop frees the port.
+						enet_host_group_destroy(group_->hosts_);
+						group_->hosts_ = 0;
+					}
+				}
 				server_ = 0;
 				status_ = NOT_ACTIVE;
+			} else {
+				// Sleep until data is received, data is pushed to the send buffer
+				// or enet needs to be serviced.
+				wakeup_.wait(getServiceTimeout(server_));
 			}
-			
-			mutex_.unlock();
-			std::chrono::milliseconds duration(50);
-			std::this_thread::sleep_for(duration);
-			mutex_.lock();
 		}
-		mutex_.unlock();
 	}
 
-	EnetServer::InternalPacket EnetServer::receive(ENetEvent eNetEvent) {
-		ENetPacket* packet = eNetEvent.packet;
-		//char id = packet->data[1];
-		//Find the id for the client which sent the package.
-		auto it = peers_.begin();
-		for (; it != peers_.end(); ++it) {
-			if (it->first == eNetEvent.peer) {
+	void EnetServer::acceptPeer(ENetPeer* peer, int id) {
+		// Assign id to client and set the next id to an uniqe value.
+		peerIndexes_[id] = peers_.size();
+		peers_.push_back(Pair(peer, id));
+		int version;
+		{
+			std::lock_guard<std::mutex> lock(group_->mutex_);
+			group_->roster_.push_back(id);
+			version = ++group_->rosterVersion_;
+		}
+
+		// The new client gets all clients, the others only the new client.
+		sendConnectInfo(peer, id);
+		sendRosterChange(JOIN_INFO, id, version);
+	}
+
+	void EnetServer::disconnectPeer(ENetPeer* peer) {
+		int id = getPeerId(peer);
+		if (id == 0) {
+			// Turned down while the server was disconnecting.
+			return;
+		}
+
+		// Remove the connection if its old (i.e. it is in the vector
+		// and not a turned down connection).
+		auto it = peerIndexes_.find(id);
+		if (it != peerIndexes_.end()) {
+			// Remove peer from vector, the last peer takes its place.
+			size_t index = it->second;
+			peerIndexes_.erase(it);
+			if (index + 1 != peers_.size()) {
+				peers_[index] = peers_.back();
+				peerIndexes_[peers_[index].second] = index;
+			}
+			peers_.pop_back();
+			int version;
+			{
+				std::lock_guard<std::mutex> lock(group_->mutex_);
+				auto rosterIt = std::find(group_->roster_.begin(), group_->roster_.end(), id);
+				if (rosterIt != group_->roster_.end()) {
+					group_->roster_.erase(rosterIt);
+				}
+				version = ++group_->rosterVersion_;
+			}
+
+			// Tell the remaining clients.
+			sendRosterChange(LEAVE_INFO, id, version);
+
+			// Signal the server that a client is disconnecting.
+			if (dispatch_ == NETWORK_THREAD) {
+				serverInterface_.disconnectToServer(id);
+			} else {
+				pushToReceiveBuffer(InternalPacket(DISCONNECT_EVENT, id, SERVER_ID));
+			}
+			return;
+		}
+
+		// Disconnected before the game thread accepted the connection.
+		if (pendingPeers_.erase(id) > 0) {
+			pushToReceiveBuffer(InternalPacket(DISCONNECT_EVENT, id, SERVER_ID));
+		}
+	}
+
+	ENetPeer* EnetServer::findPeer(int id) const {
+		auto it = peerIndexes_.find(id);
+		if (it != peerIndexes_.end()) {
+			return peers_[it->second].first;
+		}
+		return 0;
+	}
+
+	int EnetServer::nextId() {
+		// Each shard uses every n:th id, in order to not need to ask the other shards.
+		int step = (int) group_->shards_.size();
+		// Start over when the ids no longer fit in the header room of a EnetPacket.
+		do {
+			currentId_ = currentId_ <= EnetPacket::MAX_ID - step ? currentId_ + step : id_ + 1 + shard_;
+		} while (peerIndexes_.count(currentId_) > 0 || pendingPeers_.count(currentId_) > 0);
+		return currentId_;
+	}
+
+	int EnetServer::getShard(int id) const {
+		if (id <= id_) {
+			return shard_;
+		}
+		return (id - id_ - 1) % (int) group_->shards_.size();
+	}
+
+	void EnetServer::relayToShard(int shard, const InternalPacket& iPacket) {
+		// The enet packet is not shared between the shards, enet is not thread safe.
+		const EnetPacket& packet = iPacket.eNetPacket_;
+		Packet data = packet.size() > 0 ? Packet(packet.getData(), packet.size()) : iPacket.data_;
+		InternalPacket copy(std::move(data), iPacket.fromId_, iPacket.type_, iPacket.toId_, iPacket.channel_);
+		copy.aggregated_ = iPacket.aggregated_;
+		group_->shards_[shard]->pushToInbox(std::move(copy));
+	}
+
+	void EnetServer::sendRelayed() {
+		takeInbox(relayed_);
+		for (InternalPacket& iPacket : relayed_) {
+			if (iPacket.event_ == ROSTER_EVENT) {
+				// Send held back packets before the peers are told about the change.
+				flushAggregate();
+				sendToAllPeers(iPacket.data_.getData(), iPacket.data_.size(), iPacket.fromId_);
+			} else if (iPacket.toId_ == id_) {
+				// Pushed to the local client by a network thread.
+				pushToReceiveBuffer(std::move(iPacket));
+			} else {
+				queueSendPacket(iPacket);
+			}
+		}
+		relayed_.clear();
+	}
+
+	void EnetServer::handleEvent(const InternalPacket& iPacket) {
+		// Called by the game thread.
+		switch (iPacket.event_) {
+			case SERVER_RECEIVE_EVENT:
+				serverInterface_.receiveToServer(iPacket.data_, iPacket.fromId_);
+				break;
+			case CONNECT_EVENT:
+				if (serverInterface_.connectToServer(iPacket.fromId_)) {
+					acceptedIds_.push_back(iPacket.fromId_);
+					sendInternalPacket(InternalPacket(ACCEPT_EVENT, SERVER_ID, iPacket.fromId_));
+				} else {
+					sendInternalPacket(InternalPacket(REJECT_EVENT, SERVER_ID, iPacket.fromId_));
+				}
 				break;
+			case DISCONNECT_EVENT:
+			{
+				// Only signal disconnection for accepted connections.
+				auto it = std::find(acceptedIds_.begin(), acceptedIds_.end(), iPacket.fromId_);
+				if (it != acceptedIds_.end()) {
+					acceptedIds_.erase(it);
+					serverInterface_.disconnectToServer(iPacket.fromId_);
+				}
 			}
+				break;
+			default:
+				break;
+		}
+	}
+
+	void EnetServer::sendPacket(InternalPacket& iPacket) {
+		sendToPeers(iPacket);
+	}
+
+	void EnetServer::sendToPeers(InternalPacket& iPacket) {
+		// Data to send?
+		if (iPacket.data_.size() > 0 || iPacket.eNetPacket_.size() > 0) {
+			// One enet packet is shared by all receivers, created when the
+			// first receiver is found.
+			ENetPacket* eNetPacket = 0;
+			if (iPacket.toId_ == 0) {
+				// Data from a client is only relayed to interested clients.
+				bool filter = iPacket.fromId_ != SERVER_ID;
+				for (auto it = peers_.begin(); it != peers_.end(); ++it) {
+					// Send to all, but skip to return data to the sender.
+					if (iPacket.fromId_ != it->second
+						&& (!filter || serverInterface_.relayToClient(iPacket.fromId_, it->second))) {
+						if (eNetPacket == 0) {
+							eNetPacket = createEnetPacket(iPacket, iPacket.fromId_);
+						}
+						// enet handles the cleen up of eNetPacket;
+						enet_peer_send(it->first, iPacket.channel_, eNetPacket);
+					}
+				}
+			} else if (ENetPeer* peer = findPeer(iPacket.toId_)) {
+				// Send to the specific client.
+				eNetPacket = createEnetPacket(iPacket, iPacket.fromId_);
+				enet_peer_send(peer, iPacket.channel_, eNetPacket);
+			}
+			// Not sent to anyone?
+			if (eNetPacket != 0 && eNetPacket->referenceCount == 0) {
+				enet_packet_destroy(eNetPacket);
+			}
+			// Destroy the enet packet if there was no receiver.
+			iPacket.eNetPacket_ = EnetPacket();
+		}
+	}
+
+	EnetServer::InternalPacket EnetServer::receive(ENetEvent eNetEvent) {
+		ENetPacket* packet = eNetEvent.packet;
+		// The id for the client which sent the package.
+		int id = getPeerId(eNetEvent.peer);
+		if (peerIndexes_.count(id) == 0) {
+			// Not accepted yet.
+			return InternalPacket(Packet(), 0, PacketType::RELIABLE);
 		}
 
-		char id = it->second;
 		// TODO!! Stop connection which violates the protocol.
-		char type = packet->data[0];
-		char toId = packet->data[1];
+		const char* data = (const char*) packet->data;
+		int size = (int) packet->dataLength;
+		int toId;
+		int headerSize;
+		if (size < 1 || (headerSize = EnetPacket::readId(data + 1, size - 1, toId)) == 0) {
+			return InternalPacket(Packet(), 0, PacketType::RELIABLE);
+		}
+		++headerSize;
+		char type = data[0];
 		switch (type) {
+			case ROSTER_REQUEST:
+				// The client missed a change of the client list.
+				sendConnectInfo(eNetEvent.peer, id);
+				break;
 			case CONNECT_INFO:
+			case JOIN_INFO:
+			case LEAVE_INFO:
 				// ERROR. SERVER SHOULD ONLY SEND NOT RECEIVE CONNECT_INFO.
 				// TODO!! Stop connection which violates the protocol.
 				break;
 			case PACKET:
-				// [0]=type,[1]=id,[2...] = data
-				return InternalPacket(mw::Packet((char*) packet->data + 2, packet->dataLength - 2), id, PacketType::RELIABLE, toId);
+			case AGGREGATE:
+				// [0]=type,[1...]=id,[...] = data
+				// Aggregated data is size,data,size,data...
+				if (size > headerSize) {
+					// Relayed on the same channel, and as reliable or not, as it is received.
+					InternalPacket iPacket(Packet(), id, getPacketType(packet->flags), toId, eNetEvent.channelID);
+					iPacket.aggregated_ = type == AGGREGATE;
+					// Aggregated data to the local client is split into copies.
+					bool local = toId == id_ && !iPacket.aggregated_;
+					// To be relayed to remote clients or to the local client? Then take
+					// the enet packet, to relay it or pass it on without copying the data.
+					if (toId != SERVER_ID && (toId != id_ || local)) {
+						iPacket.eNetPacket_ = EnetPacket(packet);
+					}
+					// To the server or to both the local client and the remote clients?
+					if (toId == 0 || toId == SERVER_ID || (toId == id_ && !local)) {
+						iPacket.data_ = Packet(data + headerSize, size - headerSize);
+					}
+					return iPacket;
+				}
+				break;
 		}
 		// TODO!! Stop connection which violates the protocol. ERROR.
 		return InternalPacket(Packet(), 0, PacketType::RELIABLE);
 	}
 
-	// Sends connectInfo to new connected client. Client is assigned
-	// the number id.
+	// Sends connectInfo to the client. All ids are stored as in the
+	// EnetNetwork header.
 	// 0   char type = |CONNECT_INFO
-	// 1   char id   = |id
-	// 2   char id1  = |?
+	// 1   id        = |id
+	//     version   = |roster version
+	//     id1       = |?
 	//		...
-	// N-1 char idN  = |?
-	void EnetServer::sendConnectInfoToPeers(const std::vector<Pair>& peers) const {
-		char data[256];
-		data[0] = CONNECT_INFO;
-		for (const auto& pair : peers) {
-			data[1] = pair.second;
-			int size = peers.size();
-			for (int i = 0; i < size; ++i) {
-				data[i + 2] = peers[i].second;
+	//     idN       = |?
+	void EnetServer::sendConnectInfo(ENetPeer* peer, int id) const {
+		std::vector<char> data(1, CONNECT_INFO);
+		appendId(data, id);
+		{
+			std::lock_guard<std::mutex> lock(group_->mutex_);
+			appendId(data, group_->rosterVersion_);
+			for (int rosterId : group_->roster_) {
+				appendId(data, rosterId);
+			}
+		}
+
+		ENetPacket* eNetPacket = enet_packet_create(data.data(), data.size(), ENET_PACKET_FLAG_RELIABLE);
+		if (enet_peer_send(peer, 0, eNetPacket) < 0) {
+			// The peer is disconnecting, enet did not take the packet.
+			enet_packet_destroy(eNetPacket);
+		}
+	}
+
+	// 0   char type = |JOIN_INFO or LEAVE_INFO
+	// 1   id        = |id
+	//     version   = |roster version
+	void EnetServer::sendRosterChange(EnetConnectionType type, int id, int version) {
+		std::vector<char> data(1, (char) type);
+		appendId(data, id);
+		appendId(data, version);
+		sendToAllPeers(data.data(), data.size(), id);
+
+		// The clients on the other shards are told by their shard. A client
+		// getting the changes out of order asks for all clients.
+		for (int shard = 0; shard < (int) group_->shards_.size(); ++shard) {
+			if (shard != shard_) {
+				InternalPacket iPacket(ROSTER_EVENT, id, 0);
+				iPacket.data_ = Packet(data.data(), data.size());
+				group_->shards_[shard]->pushToInbox(std::move(iPacket));
 			}
+		}
+	}
 
-			ENetPacket* eNetPacket = enet_packet_create(data, size + 2, ENET_PACKET_FLAG_RELIABLE);
-			enet_peer_send(pair.first, 0, eNetPacket);
+	void EnetServer::sendToAllPeers(const char* data, int size, int exceptId) const {
+		// The same enet packet is shared by all receivers.
+		ENetPacket* eNetPacket = enet_packet_create(data, size, ENET_PACKET_FLAG_RELIABLE);
+		for (const auto& pair : peers_) {
+			if (pair.second != exceptId) {
+				enet_peer_send(pair.first, 0, eNetPacket);
+			}
+		}
+		if (eNetPacket->referenceCount == 0) {
+			enet_packet_destroy(eNetPacket);
 		}
 	}
 
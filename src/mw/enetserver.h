@@ -6,13 +6,34 @@
 
 #include <thread>
 #include <mutex>
-#include <condition_variable>
+#include <memory>
+#include <unordered_map>
 
 namespace mw {
 
+	class EnetShardedServer;
+
 	class EnetServer : public EnetNetwork, public Server {
 	public:
-		EnetServer(int port, ServerInterface& serverInterface);
+		// Decides by which thread the ServerInterface is called.
+		enum Dispatch {
+			// Called by the game thread inside pullFromReceiveBuffer(). A new
+			// connection is accepted first when the game thread has pulled.
+			GAME_THREAD,
+			// Called directly by the network thread, the ServerInterface must
+			// be thread safe in relation to the game thread. A EnetShardedServer
+			// calls it from the network threads of all shards. The push functions
+			// may be called from the callbacks, the data is then passed on by the
+			// network thread, see EnetNetwork::pushToInbox().
+			NETWORK_THREAD
+		};
+
+		// Default number of peers able to connect at the same time.
+		static const int DEFAULT_MAX_PEERS = 32;
+
+		// The number of peers is limited by enet to ENET_PROTOCOL_MAXIMUM_PEER_ID.
+		EnetServer(int port, ServerInterface& serverInterface, Dispatch dispatch = GAME_THREAD,
+			int maxPeers = DEFAULT_MAX_PEERS);
 		~EnetServer();
 
 		EnetServer(const EnetServer&) = delete;
@@ -20,7 +41,18 @@ namespace mw {
 
 		void serverPushToSendBuffer(const Packet& packet, PacketType type, int toId) override;
 
+		void serverPushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) override;
+
 		void serverPushToSendBuffer(const Packet& packet, PacketType type) override;
+
+		void serverPushToSendBuffer(const OutgoingPacket* packets, int count) override;
+
+		// Push data written directly into a enet packet, the data is not copied
+		// and the enet packet is shared by all receivers. The packet is left empty.
+		void serverPushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel = 0);
+
+		// Same as calling serverPushToSendBuffer(packet, type, 0).
+		void serverPushToSendBuffer(EnetPacket&& packet, PacketType type);
 		
 		void start() override;
 		
@@ -29,27 +61,119 @@ namespace mw {
 	protected:
 		void update();
 
+		// Data to be relayed takes the received enet packet instead of copying the data.
 		InternalPacket receive(ENetEvent eNetEvent) override;
 
+		void handleEvent(const InternalPacket& iPacket) override;
+
+		// Same as sendToPeers().
+		void sendPacket(InternalPacket& iPacket) override;
+
 	private:
+		friend class EnetShardedServer;
+
+		// The servers sharing a port in a EnetShardedServer. A server on its own
+		// is a group with one shard.
+		struct ShardGroup {
+			ShardGroup() : hosts_(0), runningShards_(0), rosterVersion_(0) {
+			}
+
+			~ShardGroup() {
+				enet_host_group_destroy(hosts_);
+			}
+
+			std::vector<EnetServer*> shards_;
+			// The hosts sharing the port, null for a server on its own. Created by
+			// EnetShardedServer before the shards are started and kept until all are
+			// stopped, in order for the clients to stay on the same shard. Destroyed
+			// by the network thread of the last shard to stop, to free the port.
+			ENetHostGroup* hosts_;
+			std::mutex mutex_; // Guards the hosts, the running shards and the roster.
+			int runningShards_; // Shards started and not yet stopped.
+			std::vector<int> roster_; // Ids of the accepted peers on all shards.
+			int rosterVersion_; // Increased by one for each change of roster_.
+		};
+
+		// Used by EnetShardedServer. The server is shard number shard in the group.
+		EnetServer(int port, ServerInterface& serverInterface, Dispatch dispatch, int maxPeers,
+			const std::shared_ptr<ShardGroup>& group, int shard);
+
+		// Called by EnetShardedServer, with the shard stopped and its network thread
+		// joined. Start the shard on its host in the group, the shard is already
+		// counted as running.
+		void startShard(ENetHost* host);
+
+		// Called with mutex_ locked. Start the network thread servicing the host.
+		void startThread(ENetHost* host);
+
+		// Return the shard which assigns the id, each shard uses every n:th id.
+		int getShard(int id) const;
+
+		// Called by the network thread. Pass a copy of the data in iPacket to the
+		// inbox of the shard, to be sent to the peers on that shard.
+		void relayToShard(int shard, const InternalPacket& iPacket);
+
+		// Called by the network thread. Send the packets in the inbox, relayed by
+		// other shards or pushed by a network thread.
+		void sendRelayed();
+
+		// Called by the network thread. Add the connected peer and tell everybody.
+		void acceptPeer(ENetPeer* peer, int id);
+
+		// Called by the network thread. Remove the peer and signal the server.
+		void disconnectPeer(ENetPeer* peer);
+
+		// Return the accepted peer with the id, or null.
+		ENetPeer* findPeer(int id) const;
+
+		// Return an id, not used by any peer, to be assigned to a new peer.
+		int nextId();
+
+		// Called by the network thread. Send the packet to the peers it is addressed to.
+		// The enet packet in iPacket is taken. A received enet packet in iPacket
+		// is relayed as it is, only the id in the header is rewritten.
+		void sendToPeers(InternalPacket& iPacket);
+
 		typedef std::pair<ENetPeer*, int> Pair; // first: Peer second: id.
 
-		// Sends connectInfo to new connected client. Client is assigned
-		// the number id.
-		// char type = |CONNECT_INFO
-		// char id   = |id
-		// char id1  = |?
+		// Sends connectInfo to the client with the id. Sent once to a new
+		// connected client, and when the client asks for it. All ids are
+		// stored as in the EnetNetwork header.
+		// char type    = |CONNECT_INFO
+		// id           = |id of the receiver
+		// version      = |roster version
+		// id1          = |?
 		//		...
-		// char idN  = |?
-		void sendConnectInfoToPeers(const std::vector<Pair>& peers) const;
-		
+		// idN          = |?
+		void sendConnectInfo(ENetPeer* peer, int id) const;
+
+		// Sends a change of the client list to all clients but the one with the id,
+		// on all shards.
+		// char type    = |JOIN_INFO or LEAVE_INFO
+		// id           = |id of the added or removed client
+		// version      = |roster version after the change
+		void sendRosterChange(EnetConnectionType type, int id, int version);
+
+		// Send the data as a reliable enet packet to all peers on this shard but
+		// the one with the id.
+		void sendToAllPeers(const char* data, int size, int exceptId) const;
+
 		int currentId_;
-		std::vector<Pair> peers_;
+		std::vector<Pair> peers_; // Accepted peers.
+		std::unordered_map<int, size_t> peerIndexes_; // Id to index in peers_.
+		std::unordered_map<int, ENetPeer*> pendingPeers_; // Waiting to be accepted by the game thread.
+		std::vector<int> acceptedIds_; // Only used by the game thread.
 		ENetAddress address_;
 		ENetHost* server_;
+		const int maxPeers_;
 
 		std::thread thread_;
 		ServerInterface& serverInterface_;
+		const Dispatch dispatch_;
+
+		const std::shared_ptr<ShardGroup> group_;
+		const int shard_;
+		std::vector<InternalPacket> relayed_; // Taken from the inbox, only used by the network thread.
 	};
 
 } // Namespace mw.
@@ -0,0 +1,250 @@
+#include "enetshardedserver.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+
+namespace mw {
+
+	EnetShardedServer::EnetShardedServer(int port, ServerInterface& serverInterface, int shards,
+		EnetServer::Dispatch dispatch, int maxPeers)
+		: group_(std::make_shared<EnetServer::ShardGroup>()), nextShard_(0) {
+
+		shards = std::max(shards, 1);
+		for (int shard = 0; shard < shards; ++shard) {
+			shards_.push_back(std::unique_ptr<EnetServer>(
+				new EnetServer(port, serverInterface, dispatch, maxPeers, group_, shard)));
+			group_->shards_.push_back(shards_.back().get());
+		}
+		batches_.resize(shards);
+	}
+
+	EnetShardedServer::~EnetShardedServer() {
+		// All network threads must be finished before any shard is destroyed,
+		// since they relay data to each other.
+		stop();
+		for (auto& shard : shards_) {
+			if (shard->thread_.joinable()) {
+				shard->thread_.join();
+			}
+		}
+	}
+
+	void EnetShardedServer::push(const Packet& packet, PacketType type, int toId, int channel, int fromId) {
+		assert(channel >= 0 && channel < CHANNELS);
+		if (packet.size() > 0) {
+			if (toId == 0) {
+				// Send to all, on all shards, and to the local client.
+				for (auto& shard : shards_) {
+					shard->sendInternalPacket(InternalPacket(packet, fromId, type, 0, channel));
+				}
+				pushLocal(fromId, packet, type);
+			} else if (toId == getId()) {
+				pushLocal(fromId, packet, type);
+			} else {
+				EnetServer& shard = *shards_[shards_[0]->getShard(toId)];
+				shard.sendInternalPacket(InternalPacket(packet, fromId, type, toId, channel));
+			}
+		}
+	}
+
+	void EnetShardedServer::push(const OutgoingPacket* packets, int count, int fromId) {
+		if (EnetServer::isNetworkThread()) {
+			// The batches are only used by the game thread.
+			for (int i = 0; i < count; ++i) {
+				push(packets[i].packet_, packets[i].type_, packets[i].toId_, packets[i].channel_, fromId);
+			}
+			return;
+		}
+		for (int i = 0; i < count; ++i) {
+			const OutgoingPacket& packet = packets[i];
+			if (packet.packet_.size() > 0) {
+				assert(packet.channel_ >= 0 && packet.channel_ < CHANNELS);
+				if (packet.toId_ == 0) {
+					for (auto& batch : batches_) {
+						batch.push_back(InternalPacket(packet.packet_, fromId, packet.type_, 0, packet.channel_));
+					}
+					pushLocal(fromId, packet.packet_, packet.type_);
+				} else if (packet.toId_ == getId()) {
+					pushLocal(fromId, packet.packet_, packet.type_);
+				} else {
+					batches_[shards_[0]->getShard(packet.toId_)].push_back(
+						InternalPacket(packet.packet_, fromId, packet.type_, packet.toId_, packet.channel_));
+				}
+			}
+		}
+		for (size_t shard = 0; shard < shards_.size(); ++shard) {
+			if (!batches_[shard].empty()) {
+				shards_[shard]->sendInternalBatch(batches_[shard]);
+			}
+		}
+	}
+
+	void EnetShardedServer::pushLocal(int fromId, const Packet& packet, PacketType type) {
+		// The first shard holds the data to the local client.
+		shards_[0]->pushLocal(InternalPacket(packet, fromId, type, getId()));
+	}
+
+	void EnetShardedServer::pushToSendBuffer(const Packet& packet, PacketType type, int toId) {
+		push(packet, type, toId, 0, getId());
+	}
+
+	void EnetShardedServer::pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) {
+		push(packet, type, toId, channel, getId());
+	}
+
+	void EnetShardedServer::pushToSendBuffer(const Packet& packet, PacketType type) {
+		push(packet, type, 0, 0, getId());
+	}
+
+	void EnetShardedServer::pushToSendBuffer(const OutgoingPacket* packets, int count) {
+		push(packets, count, getId());
+	}
+
+	void EnetShardedServer::serverPushToSendBuffer(const Packet& packet, PacketType type, int toId) {
+		push(packet, type, toId, 0, SERVER_ID);
+	}
+
+	void EnetShardedServer::serverPushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) {
+		push(packet, type, toId, channel, SERVER_ID);
+	}
+
+	void EnetShardedServer::serverPushToSendBuffer(const Packet& packet, PacketType type) {
+		push(packet, type, 0, 0, SERVER_ID);
+	}
+
+	void EnetShardedServer::serverPushToSendBuffer(const OutgoingPacket* packets, int count) {
+		push(packets, count, SERVER_ID);
+	}
+
+	void EnetShardedServer::serverPushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel) {
+		assert(channel >= 0 && channel < CHANNELS);
+		if (packet.size() > 0) {
+			if (toId == 0 || toId == getId()) {
+				pushLocal(SERVER_ID, Packet(packet.getData(), packet.size()), type);
+			}
+			if (toId != getId()) {
+				int first = toId == 0 ? 0 : shards_[0]->getShard(toId);
+				if (toId == 0) {
+					// A enet packet can only be used by one shard, the others get copies.
+					for (size_t shard = 1; shard < shards_.size(); ++shard) {
+						shards_[shard]->sendInternalPacket(InternalPacket(Packet(packet.getData(), packet.size()),
+							SERVER_ID, type, 0, channel));
+					}
+				}
+				InternalPacket iPacket(Packet(), SERVER_ID, type, toId, channel);
+				iPacket.eNetPacket_ = std::move(packet);
+				shards_[first]->sendInternalPacket(std::move(iPacket));
+			}
+		}
+	}
+
+	int EnetShardedServer::pullFromReceiveBuffer(Packet& packet) {
+		// Start with the next shard each time, in order to not starve any shard.
+		int shards = (int) shards_.size();
+		for (int i = 0; i < shards; ++i) {
+			int shard = (nextShard_ + i) % shards;
+			int id = shards_[shard]->pullFromReceiveBuffer(packet);
+			if (id != 0) {
+				nextShard_ = (shard + 1) % shards;
+				return id;
+			}
+		}
+		return 0;
+	}
+
+	int EnetShardedServer::pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) {
+		size_t size = packets.size();
+		for (auto& shard : shards_) {
+			shard->pullAllFromReceiveBuffer(packets);
+		}
+		return packets.size() - size;
+	}
+
+	void EnetShardedServer::start() {
+		if (getStatus() == ACTIVE) {
+			return;
+		}
+
+		// Wait for the shards still disconnecting. The hosts are destroyed by the
+		// last shard to stop, and all shards must run for the ids to be assigned.
+		for (auto& shard : shards_) {
+			if (shard->thread_.joinable()) {
+				shard->thread_.join();
+			}
+		}
+
+		{
+			// All sockets are bound before any shard is started, a client would
+			// else be able to connect to a shard and then be moved to another.
+			std::lock_guard<std::mutex> lock(group_->mutex_);
+			assert(group_->hosts_ == 0 && group_->runningShards_ == 0);
+			group_->hosts_ = enet_host_group_create(&shards_[0]->address_, shards_.size(),
+				shards_[0]->maxPeers_, CHANNELS, 0, 0);
+			if (group_->hosts_ == 0) {
+				fprintf(stderr, "An error occured while trying to create the ENet server hosts\n");
+				exit(EXIT_FAILURE);
+			}
+			group_->runningShards_ = (int) shards_.size();
+			group_->roster_.clear();
+			group_->rosterVersion_ = 0;
+		}
+		for (size_t shard = 0; shard < shards_.size(); ++shard) {
+			shards_[shard]->startShard(group_->hosts_->hosts[shard]);
+		}
+	}
+
+	void EnetShardedServer::stop() {
+		for (auto& shard : shards_) {
+			shard->stop();
+		}
+	}
+
+	int EnetShardedServer::getId() const {
+		return shards_[0]->getId();
+	}
+
+	Network::Status EnetShardedServer::getStatus() const {
+		bool active = false;
+		bool disconnecting = false;
+		for (const auto& shard : shards_) {
+			Status status = shard->getStatus();
+			active = active || status == ACTIVE;
+			disconnecting = disconnecting || status == DISCONNECTING;
+		}
+		if (active) {
+			return ACTIVE;
+		}
+		return disconnecting ? DISCONNECTING : NOT_ACTIVE;
+	}
+
+	void EnetShardedServer::setCompression(EnetNetwork::Compression compression) {
+		for (auto& shard : shards_) {
+			shard->setCompression(compression);
+		}
+	}
+
+	void EnetShardedServer::setCompressionDictionary(const std::vector<char>& dictionary) {
+		for (auto& shard : shards_) {
+			shard->setCompressionDictionary(dictionary);
+		}
+	}
+
+	EnetNetwork::CompressionStats EnetShardedServer::getCompressionStats() const {
+		EnetNetwork::CompressionStats stats = {0, 0, 0, 0};
+		for (const auto& shard : shards_) {
+			EnetNetwork::CompressionStats shardStats = shard->getCompressionStats();
+			stats.sentBytes += shardStats.sentBytes;
+			stats.sentCompressedBytes += shardStats.sentCompressedBytes;
+			stats.receivedCompressedBytes += shardStats.receivedCompressedBytes;
+			stats.receivedBytes += shardStats.receivedBytes;
+		}
+		return stats;
+	}
+
+	int EnetShardedServer::getShards() const {
+		return (int) shards_.size();
+	}
+
+} // Namespace mw.
@@ -0,0 +1,94 @@
+#ifndef MW_ENETSHARDEDSERVER_H
+#define MW_ENETSHARDEDSERVER_H
+
+#include "enetserver.h"
+
+#include <memory>
+#include <vector>
+
+namespace mw {
+
+	// A server using several EnetServer shards on the same port, each with its own
+	// enet host and network thread, in order to use more than one core. The system
+	// spreads the clients between the shards by the client address (SO_REUSEPORT,
+	// not supported on all platforms). The hosts are kept from start() until all
+	// shards are stopped, so a client stays on its shard, see enet_host_group_create.
+	// The last shard to stop destroys them, freeing the port.
+	// The application sees one server, the ids are unique over all shards and data
+	// to a client on another shard is relayed.
+	class EnetShardedServer : public Network, public Server {
+	public:
+		// Each shard accepts up to maxPeers clients.
+		EnetShardedServer(int port, ServerInterface& serverInterface, int shards,
+			EnetServer::Dispatch dispatch = EnetServer::GAME_THREAD,
+			int maxPeers = EnetServer::DEFAULT_MAX_PEERS);
+		~EnetShardedServer();
+
+		EnetShardedServer(const EnetShardedServer&) = delete;
+		EnetShardedServer& operator=(const EnetShardedServer&) = delete;
+
+		void pushToSendBuffer(const Packet& packet, PacketType type, int toId) override;
+
+		void pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) override;
+
+		void pushToSendBuffer(const Packet& packet, PacketType type) override;
+
+		void pushToSendBuffer(const OutgoingPacket* packets, int count) override;
+
+		// Pulls from the shards in turn.
+		int pullFromReceiveBuffer(Packet& packet) override;
+
+		int pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) override;
+
+		void serverPushToSendBuffer(const Packet& packet, PacketType type, int toId) override;
+
+		void serverPushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) override;
+
+		void serverPushToSendBuffer(const Packet& packet, PacketType type) override;
+
+		void serverPushToSendBuffer(const OutgoingPacket* packets, int count) override;
+
+		// Same as EnetServer::serverPushToSendBuffer(EnetPacket&&, ...). Data sent to
+		// all is copied for all shards but one.
+		void serverPushToSendBuffer(EnetPacket&& packet, PacketType type, int toId, int channel = 0);
+
+		void start() override;
+
+		void stop() override;
+
+		int getId() const override;
+
+		// Active if any shard is active.
+		Status getStatus() const override;
+
+		// Used by all shards, see EnetNetwork.
+		void setCompression(EnetNetwork::Compression compression);
+
+		void setCompressionDictionary(const std::vector<char>& dictionary);
+
+		// The sum of the stats of all shards.
+		EnetNetwork::CompressionStats getCompressionStats() const;
+
+		int getShards() const;
+
+	private:
+		typedef EnetServer::InternalPacket InternalPacket;
+
+		// Push the packet, sent from fromId, to the shards it is addressed to.
+		void push(const Packet& packet, PacketType type, int toId, int channel, int fromId);
+
+		// Push count packets at once to each shard, see EnetNetwork::sendInternalPackets.
+		void push(const OutgoingPacket* packets, int count, int fromId);
+
+		// Push the packet, sent from fromId, to the local client.
+		void pushLocal(int fromId, const Packet& packet, PacketType type);
+
+		std::shared_ptr<EnetServer::ShardGroup> group_;
+		std::vector<std::unique_ptr<EnetServer>> shards_;
+		std::vector<std::vector<InternalPacket>> batches_; // One for each shard, only used in push().
+		int nextShard_; // The shard pulled from first.
+	};
+
+} // Namespace mw.
+
+#endif // MW_ENETSHARDEDSERVER_H
@@ -0,0 +1,70 @@
+#include "enetwakeup.h"
+
+#include <cstdio>
+
+namespace mw {
+
+	EnetWakeup::EnetWakeup() : waiter_(0), host_(0), pending_(false) {
+	}
+
+	EnetWakeup::~EnetWakeup() {
+		close();
+	}
+
+	bool EnetWakeup::open() {
+		if (waiter_ == 0) {
+			waiter_ = enet_host_waiter_create();
+		}
+		return waiter_ != 0;
+	}
+
+	void EnetWakeup::close() {
+		if (waiter_ != 0) {
+			enet_host_waiter_destroy(waiter_);
+			waiter_ = 0;
+		}
+		host_ = 0;
+		pending_ = false;
+	}
+
+	void EnetWakeup::wakeUp() {
+		// Only one signal is needed to wake the thread.
+		if (waiter_ != 0 && !pending_.exchange(true)) {
+			enet_host_waiter_wake(waiter_);
+		}
+	}
+
+	void EnetWakeup::setHost(ENetHost* host) {
+		if (waiter_ != 0) {
+			if (host_ != 0) {
+				enet_host_waiter_remove(waiter_, host_);
+			}
+			if (host != 0 && enet_host_waiter_add(waiter_, host) < 0) {
+				fprintf(stderr, "An error occured while waiting on the ENet host.\n");
+			}
+		}
+		host_ = host;
+	}
+
+	void EnetWakeup::wait(enet_uint32 timeout) {
+		if (waiter_ == 0) {
+			// No wake up possible, only wait for the host.
+			if (host_ != 0) {
+				enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+				enet_socket_wait(host_->socket, &condition, timeout);
+			}
+			return;
+		}
+
+		// Also returns at once when datagrams of the last batched receive of
+		// the host are not handled yet.
+		ENetHost* ready;
+		enet_host_waiter_wait(waiter_, &ready, 1, timeout);
+
+		// The waiter drained the wake up. A wake up after the reset signals
+		// anew and is kept for the next wait. A wake up before the reset signals
+		// nothing, but the data it signals is handled anyway when this call returns.
+		pending_.store(false);
+	}
+
+} // Namespace mw.
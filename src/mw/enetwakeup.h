@@ -0,0 +1,49 @@
+#ifndef MW_ENETWAKEUP_H
+#define MW_ENETWAKEUP_H
+
+#include <enet/enet.h>
+
+#include <atomic>
+
+namespace mw {
+
+	// Makes it possible to block a network thread on a enet host and still
+	// be able to wake it up from another thread. Waits by a ENetHostWaiter,
+	// i.e. by epoll and an eventfd on Linux, which has no limit on the socket
+	// descriptor, unlike select.
+	class EnetWakeup {
+	public:
+		EnetWakeup();
+		~EnetWakeup();
+
+		EnetWakeup(const EnetWakeup&) = delete;
+		EnetWakeup& operator=(const EnetWakeup&) = delete;
+
+		// Create the waiter. Enet must be initialized before.
+		// Return true on success.
+		bool open();
+
+		// Destroy the waiter. Must be called before enet is deinitialized.
+		void close();
+
+		// Wake up the thread blocked in wait(). Safe to call from any thread.
+		// Several calls before the thread wakes up only result in one wake up.
+		void wakeUp();
+
+		// Called by the network thread. Wait on the host from now on, instead of
+		// the previous one. Must be called with null before the host is destroyed.
+		void setHost(ENetHost* host);
+
+		// Called by the network thread. Block until the host has data to receive,
+		// wakeUp() is called or the timeout in milliseconds expires.
+		void wait(enet_uint32 timeout);
+
+	private:
+		ENetHostWaiter* waiter_;
+		ENetHost* host_;
+		std::atomic<bool> pending_;
+	};
+
+} // Namespace mw.
+
+#endif // MW_ENETWAKEUP_H
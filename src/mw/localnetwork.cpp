@@ -9,7 +9,7 @@ namespace mw {
 		status_ = Network::NOT_ACTIVE;
 	}
 
-	void LocalNetwork::pushToSendBuffer(const Packet& packet, Network::PacketType type, int toId, bool server) {
+	void LocalNetwork::push(const Packet& packet, int toId, bool server) {
 		if (packet.size() > 0) {
 			if (toId == 0) {
 				buffer_.push(Data(packet, server));
@@ -25,24 +25,44 @@ namespace mw {
 		}
 	}
 
-	void LocalNetwork::pushToSendBuffer(const Packet& packet, PacketType type, int toId) {	
-		pushToSendBuffer(packet, type, toId, false);
+	void LocalNetwork::pushToSendBuffer(const Packet& packet, PacketType /*type*/, int toId) {	
+		push(packet, toId, false);
+	}
+
+	void LocalNetwork::pushToSendBuffer(const Packet& packet, PacketType /*type*/, int toId, int /*channel*/) {
+		push(packet, toId, false);
 	}
 
 	// Send data to receiveBuffer.
 	// Send data through serverfilter (if there is one).
-	void LocalNetwork::pushToSendBuffer(const Packet& packet, PacketType type) {
-		pushToSendBuffer(packet, type, 0, false);
+	void LocalNetwork::pushToSendBuffer(const Packet& packet, PacketType /*type*/) {
+		push(packet, 0, false);
 	}
 
-	void LocalNetwork::serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId) {
-		pushToSendBuffer(packet, type, toId, true);
+	void LocalNetwork::pushToSendBuffer(const OutgoingPacket* packets, int count) {
+		for (int i = 0; i < count; ++i) {
+			push(packets[i].packet_, packets[i].toId_, false);
+		}
+	}
+
+	void LocalNetwork::serverPushToSendBuffer(const Packet& packet, Network::PacketType /*type*/, int toId) {
+		push(packet, toId, true);
 		// Must be sent to the local client, or to everybody which is the same as the local client.
 		assert(toId == 0 || toId == getId());
 	}
 
-	void LocalNetwork::serverPushToSendBuffer(const Packet& packet, Network::PacketType type) {
-		pushToSendBuffer(packet, type, 0, true);
+	void LocalNetwork::serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId, int /*channel*/) {
+		serverPushToSendBuffer(packet, type, toId);
+	}
+
+	void LocalNetwork::serverPushToSendBuffer(const Packet& packet, Network::PacketType /*type*/) {
+		push(packet, 0, true);
+	}
+
+	void LocalNetwork::serverPushToSendBuffer(const Network::OutgoingPacket* packets, int count) {
+		for (int i = 0; i < count; ++i) {
+			serverPushToSendBuffer(packets[i].packet_, packets[i].type_, packets[i].toId_);
+		}
 	}
 
 	// Receives data from server.	
@@ -59,6 +79,17 @@ namespace mw {
 		return id;
 	}
 
+	int LocalNetwork::pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) {
+		int size = buffer_.size();
+		while (!buffer_.empty()) {
+			Data& data = buffer_.front();
+			int id = data.server_ ? SERVER_ID : getId();
+			packets.push_back(std::make_pair(id, std::move(data.packet_)));
+			buffer_.pop();
+		}
+		return size;
+	}
+
 	void LocalNetwork::start() {
 		if (status_ == Network::NOT_ACTIVE) {
 			status_ = Network::ACTIVE;
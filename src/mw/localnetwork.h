@@ -14,17 +14,28 @@ namespace mw {
 
 		void pushToSendBuffer(const Packet& packet, PacketType type, int toId) override;
 
+		// There are no channels, the data is received in the order it is pushed.
+		void pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) override;
+
 		// Send data to receiveBuffer.
 		// Send data through serverfilter (if there is one).
 		void pushToSendBuffer(const Packet& packet, PacketType type) override;
 
+		void pushToSendBuffer(const OutgoingPacket* packets, int count) override;
+
 		// Receives data from server.	
 		int pullFromReceiveBuffer(Packet& packet) override;
 
+		int pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) override;
+
 		void serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId) override;
 
+		void serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId, int channel) override;
+
 		void serverPushToSendBuffer(const Packet& packet, Network::PacketType type) override;
 
+		void serverPushToSendBuffer(const Network::OutgoingPacket* packets, int count) override;
+
 		void start() override;
 
 		void stop() override;
@@ -35,7 +46,7 @@ namespace mw {
 		Status getStatus() const override;
 
 	private:
-		void pushToSendBuffer(const Packet& packet, Network::PacketType type, int toId, bool server);
+		void push(const Packet& packet, int toId, bool server);
 
 		struct Data {
 			Data() {
@@ -0,0 +1,197 @@
+#include "lzcompressor.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mw {
+
+	namespace {
+
+		uint32_t read32(const enet_uint8* data) {
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		// Write a length continued from a token, return false if out of room.
+		bool writeLength(enet_uint8*& out, const enet_uint8* outEnd, size_t length) {
+			while (length >= 255) {
+				if (out == outEnd) {
+					return false;
+				}
+				*out++ = 255;
+				length -= 255;
+			}
+			if (out == outEnd) {
+				return false;
+			}
+			*out++ = (enet_uint8) length;
+			return true;
+		}
+
+		// Read a length continued from a token, return false if the data ends.
+		bool readLength(const enet_uint8*& in, const enet_uint8* inEnd, size_t& length) {
+			enet_uint8 byte;
+			do {
+				if (in == inEnd) {
+					return false;
+				}
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		}
+
+		// Write a sequence, return false if out of room.
+		bool writeSequence(enet_uint8*& out, const enet_uint8* outEnd, const enet_uint8* literals,
+			size_t literalLength, size_t offset, size_t matchLength) {
+
+			if (out == outEnd) {
+				return false;
+			}
+			enet_uint8* token = out++;
+			*token = (enet_uint8) (std::min<size_t>(literalLength, 15) << 4);
+			if (literalLength >= 15 && !writeLength(out, outEnd, literalLength - 15)) {
+				return false;
+			}
+			if (literalLength > (size_t) (outEnd - out)) {
+				return false;
+			}
+			std::memcpy(out, literals, literalLength);
+			out += literalLength;
+
+			if (matchLength == 0) {
+				// The last sequence.
+				return true;
+			}
+			if (outEnd - out < 2) {
+				return false;
+			}
+			*out++ = (enet_uint8) (offset & 0xFF);
+			*out++ = (enet_uint8) (offset >> 8);
+			matchLength -= 4;
+			*token |= (enet_uint8) std::min<size_t>(matchLength, 15);
+			return matchLength < 15 || writeLength(out, outEnd, matchLength - 15);
+		}
+
+	}
+
+	LzCompressor::LzCompressor(const std::vector<char>& dictionary)
+		: dictionaryTable_(HASH_SIZE, -1), table_(HASH_SIZE, 0), generations_(HASH_SIZE, 0), generation_(0) {
+
+		dictionarySize_ = (int) dictionary.size() < MAX_DICTIONARY_SIZE ? (int) dictionary.size() : MAX_DICTIONARY_SIZE;
+		buffer_.assign(dictionary.end() - dictionarySize_, dictionary.end());
+		for (int i = 0; i + MIN_MATCH <= dictionarySize_; ++i) {
+			dictionaryTable_[hash(buffer_.data() + i)] = i;
+		}
+	}
+
+	uint32_t LzCompressor::hash(const enet_uint8* data) {
+		return (read32(data) * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	size_t LzCompressor::compress(const ENetBuffer* inBuffers, size_t inBufferCount, size_t inLimit,
+		enet_uint8* outData, size_t outLimit) {
+
+		// Gather the datagram after the dictionary.
+		buffer_.resize(dictionarySize_ + inLimit);
+		enet_uint8* data = buffer_.data();
+		size_t size = 0;
+		for (size_t i = 0; i < inBufferCount && size < inLimit; ++i) {
+			size_t length = std::min(inBuffers[i].dataLength, inLimit - size);
+			std::memcpy(data + dictionarySize_ + size, inBuffers[i].data, length);
+			size += length;
+		}
+
+		// Invalidates all datagram positions in table_.
+		if (++generation_ == 0) {
+			std::fill(generations_.begin(), generations_.end(), 0);
+			generation_ = 1;
+		}
+
+		const enet_uint8* end = data + dictionarySize_ + size;
+		const enet_uint8* anchor = data + dictionarySize_;
+		const enet_uint8* in = anchor;
+		enet_uint8* out = outData;
+		const enet_uint8* outEnd = outData + outLimit;
+
+		while (end - in >= MIN_MATCH) {
+			uint32_t h = hash(in);
+			int candidate = generations_[h] == generation_ ? table_[h] : dictionaryTable_[h];
+			int position = (int) (in - data);
+			table_[h] = position;
+			generations_[h] = generation_;
+
+			if (candidate >= 0 && position - candidate <= MAX_OFFSET && read32(data + candidate) == read32(in)) {
+				size_t length = MIN_MATCH;
+				while (in + length < end && data[candidate + length] == in[length]) {
+					++length;
+				}
+				if (!writeSequence(out, outEnd, anchor, in - anchor, position - candidate, length)) {
+					return 0;
+				}
+				in += length;
+				anchor = in;
+			} else {
+				++in;
+			}
+		}
+		if (!writeSequence(out, outEnd, anchor, end - anchor, 0, 0)) {
+			return 0;
+		}
+		return out - outData;
+	}
+
+	size_t LzCompressor::decompress(const enet_uint8* inData, size_t inLimit, enet_uint8* outData, size_t outLimit) {
+		// Decompress after the dictionary, in order to copy matches from it.
+		buffer_.resize(dictionarySize_ + outLimit);
+		enet_uint8* data = buffer_.data();
+		enet_uint8* out = data + dictionarySize_;
+		const enet_uint8* outEnd = out + outLimit;
+		const enet_uint8* in = inData;
+		const enet_uint8* inEnd = inData + inLimit;
+
+		while (in < inEnd) {
+			enet_uint8 token = *in++;
+			size_t literalLength = token >> 4;
+			if (literalLength == 15 && !readLength(in, inEnd, literalLength)) {
+				return 0;
+			}
+			if (literalLength > (size_t) (inEnd - in) || literalLength > (size_t) (outEnd - out)) {
+				return 0;
+			}
+			std::memcpy(out, in, literalLength);
+			in += literalLength;
+			out += literalLength;
+
+			if (in == inEnd) {
+				// The last sequence.
+				break;
+			}
+			if (inEnd - in < 2) {
+				return 0;
+			}
+			size_t offset = in[0] | (in[1] << 8);
+			in += 2;
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !readLength(in, inEnd, matchLength)) {
+				return 0;
+			}
+			matchLength += MIN_MATCH;
+			if (offset == 0 || offset > (size_t) (out - data) || matchLength > (size_t) (outEnd - out)) {
+				return 0;
+			}
+			// The match may overlap the output, copy byte by byte.
+			const enet_uint8* match = out - offset;
+			for (size_t i = 0; i < matchLength; ++i) {
+				out[i] = match[i];
+			}
+			out += matchLength;
+		}
+
+		size_t size = out - (data + dictionarySize_);
+		std::memcpy(outData, data + dictionarySize_, size);
+		return size;
+	}
+
+} // Namespace mw.
@@ -0,0 +1,63 @@
+#ifndef MW_LZCOMPRESSOR_H
+#define MW_LZCOMPRESSOR_H
+
+#include <enet/enet.h>
+
+#include <vector>
+#include <cstdint>
+
+namespace mw {
+
+	// A fast byte oriented LZ77 compressor for enet datagrams, in the style of
+	// LZ4. Each datagram is compressed on its own, as a list of sequences:
+	// token         | high 4 bits: literal length, low 4 bits: match length - 4.
+	//               | 15 means the length continues in the following bytes,
+	//               | which are added until a byte less than 255.
+	// literals      |
+	// offset        | 2 bytes, little endian. Missing in the last sequence.
+	// match length  | The rest of the match length, if any.
+	//
+	// An optional dictionary, e.g. typical messages, is used as data seen before
+	// each datagram, which makes small datagrams compress well. The compressor
+	// and the decompressor must use the same dictionary.
+	// Not thread safe, used by one enet host.
+	class LzCompressor {
+	public:
+		// Only the last MAX_DICTIONARY_SIZE bytes of a dictionary are used.
+		static const int MAX_DICTIONARY_SIZE = 32 * 1024;
+
+		explicit LzCompressor(const std::vector<char>& dictionary = std::vector<char>());
+
+		LzCompressor(const LzCompressor&) = delete;
+		LzCompressor& operator=(const LzCompressor&) = delete;
+
+		// Same as ENetCompressor::compress. Return 0 if the data does not fit in outLimit bytes.
+		size_t compress(const ENetBuffer* inBuffers, size_t inBufferCount, size_t inLimit,
+			enet_uint8* outData, size_t outLimit);
+
+		// Same as ENetCompressor::decompress. Return 0 if the data is not valid.
+		size_t decompress(const enet_uint8* inData, size_t inLimit, enet_uint8* outData, size_t outLimit);
+
+	private:
+		static const int HASH_BITS = 12;
+		static const int HASH_SIZE = 1 << HASH_BITS;
+		static const int MIN_MATCH = 4;
+		static const int MAX_OFFSET = 0xFFFF;
+
+		static uint32_t hash(const enet_uint8* data);
+
+		std::vector<enet_uint8> buffer_; // The dictionary followed by the current datagram.
+		int dictionarySize_;
+
+		// Last position for each hash, positions in the dictionary are stored once
+		// in dictionaryTable_, positions in the datagram in table_ which is only
+		// valid for the current generation.
+		std::vector<int> dictionaryTable_;
+		std::vector<int> table_;
+		std::vector<uint32_t> generations_;
+		uint32_t generation_;
+	};
+
+} // Namespace mw.
+
+#endif // MW_LZCOMPRESSOR_H
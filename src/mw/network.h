@@ -4,6 +4,7 @@
 #include "packet.h"
 
 #include <vector>
+#include <utility>
 
 namespace mw {
 
@@ -15,14 +16,39 @@ namespace mw {
 	public:
 		static const int SERVER_ID = 1;
 
+		// Number of channels. Data on different channels is ordered independently,
+		// i.e. a lost reliable packet only delays the data on the same channel.
+		static const int CHANNELS = 4;
+
 		enum Status {
 			ACTIVE, DISCONNECTING, NOT_ACTIVE
 		};
 
 		enum PacketType {
-			RELIABLE, UN_RELIABLE
+			// Always arrives, in order.
+			RELIABLE,
+			// May be lost, in order. Large data is sent as unreliable fragments.
+			UN_RELIABLE,
+			// May be lost, in any order. No data is held back or dropped for
+			// being out of order. Large data is sent reliably in fragments.
+			UN_SEQUENCED,
+			// May be lost, in order. Large data is sent reliably in fragments.
+			UN_RELIABLE_SEQUENCED
 		};		
 
+		// Data to be pushed together with other data in one call.
+		class OutgoingPacket {
+		public:
+			OutgoingPacket(const Packet& packet, PacketType type, int toId, int channel = 0)
+				: packet_(packet), type_(type), toId_(toId), channel_(channel) {
+			}
+
+			Packet packet_;
+			PacketType type_;
+			int toId_; // Same meaning as toId in pushToSendBuffer.
+			int channel_;
+		};
+
 		virtual ~Network() {
 		}
 
@@ -33,14 +59,28 @@ namespace mw {
 		// toId = N, N > 1 sends the data to the client with corresponding id.
 		virtual void pushToSendBuffer(const Packet& packet, PacketType type, int toId) = 0;
 
+		// Same as pushToSendBuffer(packet, type, toId) but sent on the channel,
+		// 0 <= channel < CHANNELS. The other push functions use channel 0.
+		virtual void pushToSendBuffer(const Packet& packet, PacketType type, int toId, int channel) = 0;
+
 		// Push the data (packet) to all clients.
 		// Same as calling pushToSendBuffer(packet, type, 0).
 		virtual void pushToSendBuffer(const Packet& packet, PacketType type) = 0;
 
+		// Push count packets at once, in order. Same as calling pushToSendBuffer
+		// for each packet, but all packets are handed over to the network at the
+		// same time, making it possible to send them together.
+		virtual void pushToSendBuffer(const OutgoingPacket* packets, int count) = 0;
+
 		// Pulls received data.
 		// Local sent data this client passes without going through the internet.
 		virtual int pullFromReceiveBuffer(Packet& packet) = 0;
 
+		// Pulls all received data in one call, in the same order as repeated
+		// calls to pullFromReceiveBuffer(). Each packet is appended to the vector
+		// together with the sender id. Return the number of appended packets.
+		virtual int pullAllFromReceiveBuffer(std::vector<std::pair<int, Packet>>& packets) = 0;
+
 		// Start the connection to the server.
 		virtual void start() = 0;
 
@@ -0,0 +1,93 @@
+#include "packet.h"
+
+#include <mutex>
+#include <vector>
+
+namespace mw {
+
+	namespace {
+
+		// Buffers are pooled in classes of power of two sizes, from the
+		// smallest size larger than Packet::INLINE_SIZE up to Packet::MAX_SIZE.
+		const int MIN_BUFFER_SIZE = 2 * Packet::INLINE_SIZE;
+
+		// Max number of free buffers kept for each size, the rest is deleted.
+		const size_t MAX_FREE_BUFFERS = 64;
+
+		class BufferPool {
+		public:
+			char* acquire(int& capacity) {
+				int sizeClass = getSizeClass(capacity);
+				capacity = MIN_BUFFER_SIZE << sizeClass;
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					std::vector<char*>& buffers = free_[sizeClass];
+					if (!buffers.empty()) {
+						char* buffer = buffers.back();
+						buffers.pop_back();
+						return buffer;
+					}
+				}
+				return new char[capacity];
+			}
+
+			void release(char* buffer, int capacity) {
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					std::vector<char*>& buffers = free_[getSizeClass(capacity)];
+					if (buffers.size() < MAX_FREE_BUFFERS) {
+						buffers.push_back(buffer);
+						return;
+					}
+				}
+				delete[] buffer;
+			}
+
+		private:
+			static int getSizeClass(int size) {
+				int sizeClass = 0;
+				while ((MIN_BUFFER_SIZE << sizeClass) < size) {
+					++sizeClass;
+				}
+				return sizeClass;
+			}
+
+			static const int NBR_OF_SIZE_CLASSES = 10;
+			static_assert((MIN_BUFFER_SIZE << (NBR_OF_SIZE_CLASSES - 1)) >= (int) Packet::MAX_SIZE, "Packet::MAX_SIZE must fit in a size class");
+
+			std::mutex mutex_;
+			std::vector<char*> free_[NBR_OF_SIZE_CLASSES];
+		};
+
+		BufferPool& getBufferPool() {
+			// Never destroyed, in order to be usable by static packets.
+			static BufferPool* pool = new BufferPool;
+			return *pool;
+		}
+
+	} // Anonymous namespace.
+
+	char* Packet::acquireBuffer(int& capacity) {
+		return getBufferPool().acquire(capacity);
+	}
+
+	void Packet::releaseBuffer(char* buffer, int capacity) {
+		getBufferPool().release(buffer, capacity);
+	}
+
+	bool Packet::grow(int size) {
+		if (size > (int) MAX_SIZE) {
+			return false;
+		}
+		int capacity = std::min(std::max(size, 2 * capacity_), (int) MAX_SIZE);
+		char* buffer = acquireBuffer(capacity);
+		std::copy(getData(), getData() + size_, buffer);
+		if (buffer_ != 0) {
+			releaseBuffer(buffer_, capacity_);
+		}
+		buffer_ = buffer;
+		capacity_ = capacity;
+		return true;
+	}
+
+} // Namespace mw.
@@ -3,33 +3,81 @@
 
 #include <array>
 #include <algorithm>
+#include <cstddef>
 
 namespace mw {
 
+	// Holds data to be sent or received. Data up to INLINE_SIZE bytes is stored
+	// inside the packet without any allocation. Larger data is stored in a buffer
+	// taken from a shared pool, which is returned to the pool when the packet is
+	// destroyed. All writes and reads are bounds checked, a write which would make
+	// the packet larger than MAX_SIZE or a read past the end is ignored and marks
+	// the packet as failed.
 	class Packet {
 	public:
-		static const size_t MAX_SIZE = 128;
+		// Max number of bytes stored without using a pooled buffer.
+		static const size_t INLINE_SIZE = 128;
+
+		// Max number of bytes a packet can hold.
+		static const size_t MAX_SIZE = 64 * 1024;
 
 		Packet() {
-			index_ = 0;
-			size_ = 0;
+			init();
 		}
 
 		Packet(const char* data, int size) {
-			index_ = 0;
-			std::copy(data, data + size, data_.data());
-			size_ = size;
+			init();
+			append(data, size);
+		}
+
+		Packet(const Packet& packet) {
+			init();
+			append(packet.getData(), packet.size_);
+			index_ = packet.index_;
+			fail_ = packet.fail_;
+		}
+
+		Packet(Packet&& packet) {
+			init();
+			moveFrom(packet);
+		}
+
+		~Packet() {
+			if (buffer_ != 0) {
+				releaseBuffer(buffer_, capacity_);
+			}
+		}
+
+		Packet& operator=(const Packet& packet) {
+			if (this != &packet) {
+				clear();
+				append(packet.getData(), packet.size_);
+				index_ = packet.index_;
+				fail_ = packet.fail_;
+			}
+			return *this;
+		}
+
+		Packet& operator=(Packet&& packet) {
+			if (this != &packet) {
+				clear();
+				moveFrom(packet);
+			}
+			return *this;
 		}
 
-		// Dangerous if the size of the packet is to big.
 		Packet& operator<<(const Packet& packet) {
-			std::copy(packet.data_.data(), packet.data_.data() + packet.size_, data_.data() + size_);
-			size_ += packet.size_;
+			append(packet.getData(), packet.size_);
 			return *this;
 		}
 
 		Packet& operator>>(char& byte) {
-			byte = data_[index_++];
+			if (index_ < size_) {
+				byte = getData()[index_++];
+			} else {
+				byte = 0;
+				fail_ = true;
+			}
 			return *this;
 		}
 
@@ -39,29 +87,109 @@ namespace mw {
 		}
 
 		const char* getData() const {
-			return data_.data();
+			return buffer_ != 0 ? buffer_ : inline_.data();
 		}
 
 		int size() const {
 			return size_;
 		}
 
+		// Return the number of bytes the packet can hold without taking a new buffer.
+		int capacity() const {
+			return capacity_;
+		}
+
 		inline void push_back(char byte) {
-			data_[size_++] = byte;
+			if (size_ < capacity_ || reserve(size_ + 1)) {
+				data()[size_++] = byte;
+			} else {
+				fail_ = true;
+			}
+		}
+
+		// Append size bytes of data to the end of the packet.
+		void append(const char* data, int size) {
+			if (size <= 0) {
+				return;
+			}
+			if (reserve(size_ + size)) {
+				std::copy(data, data + size, this->data() + size_);
+				size_ += size;
+			} else {
+				fail_ = true;
+			}
+		}
+
+		// Make the packet able to hold size bytes without taking a new buffer.
+		// Return false if size is larger than MAX_SIZE.
+		bool reserve(int size) {
+			return size <= capacity_ || grow(size);
+		}
+
+		// Remove all data and reset the read position and the fail flag.
+		// A pooled buffer is kept.
+		void clear() {
+			index_ = 0;
+			size_ = 0;
+			fail_ = false;
 		}
 
 		char operator[](int index) const {
-			return data_[index];
+			return getData()[index];
 		}
 
 		unsigned int dataLeftToRead() const {
 			return size_ - index_;
 		}
 
+		// Return true if a write or read has been out of bounds.
+		bool fail() const {
+			return fail_;
+		}
+
 	private:
-		std::array<char, MAX_SIZE> data_;
+		// Return a buffer with at least the capacity of bytes.
+		// The capacity is changed to the real capacity of the buffer.
+		static char* acquireBuffer(int& capacity);
+
+		// Return the buffer to the pool.
+		static void releaseBuffer(char* buffer, int capacity);
+
+		// Move the data to a larger pooled buffer.
+		bool grow(int size);
+
+		void init() {
+			buffer_ = 0;
+			capacity_ = INLINE_SIZE;
+			index_ = 0;
+			size_ = 0;
+			fail_ = false;
+		}
+
+		char* data() {
+			return buffer_ != 0 ? buffer_ : inline_.data();
+		}
+
+		// Take the data from the packet, which is left empty. This packet must be empty.
+		void moveFrom(Packet& packet) {
+			if (packet.buffer_ != 0) {
+				std::swap(buffer_, packet.buffer_);
+				std::swap(capacity_, packet.capacity_);
+			} else {
+				std::copy(packet.inline_.data(), packet.inline_.data() + packet.size_, data());
+			}
+			size_ = packet.size_;
+			index_ = packet.index_;
+			fail_ = packet.fail_;
+			packet.clear();
+		}
+
+		std::array<char, INLINE_SIZE> inline_;
+		char* buffer_; // Pooled buffer, null when using inline_.
+		int capacity_;
 		int index_;
 		int size_;
+		bool fail_;
 	};
 
 } // Namespace mw.
@@ -18,6 +18,16 @@ namespace mw {
 		virtual bool connectToServer(int clientId) = 0;
 
 		virtual void disconnectToServer(int clientId) = 0;
+
+		// Return true if data sent to all by the client with id fromId should be
+		// relayed to the client with id toId. Makes it possible to only relay
+		// data to interested clients, e.g. clients nearby on the map.
+		// Called by the network thread for each receiver, must be fast and thread
+		// safe in relation to the game thread. Not called for data sent by the
+		// server or to a specific client. The local client always gets the data.
+		virtual bool relayToClient(int /*fromId*/, int /*toId*/) {
+			return true;
+		}
 	};
 
 	// This class works as a server.
@@ -30,7 +40,13 @@ namespace mw {
 
 		virtual void serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId) = 0;
 
+		// Sent on the channel, 0 <= channel < Network::CHANNELS.
+		virtual void serverPushToSendBuffer(const Packet& packet, Network::PacketType type, int toId, int channel) = 0;
+
 		virtual void serverPushToSendBuffer(const Packet& packet, Network::PacketType type) = 0;
+
+		// Push count packets at once, in order, sent from the server.
+		virtual void serverPushToSendBuffer(const Network::OutgoingPacket* packets, int count) = 0;
 	};
 
 } // Namespace mw.
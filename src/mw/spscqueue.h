@@ -0,0 +1,135 @@
+#ifndef MW_SPSCQUEUE_H
+#define MW_SPSCQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace mw {
+
+	// A bounded lock-free queue for exactly one producer thread and one
+	// consumer thread. The capacity is rounded up to a power of two.
+	// All memory is allocated in the constructor.
+	template <class T>
+	class SpscQueue {
+	public:
+		explicit SpscQueue(size_t capacity) : head_(0), tail_(0) {
+			size_t size = 1;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			buffer_.resize(size);
+			mask_ = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Only called by the producer. Return false if the queue is full,
+		// the value is then untouched.
+		bool push(T&& value) {
+			size_t tail = tail_.load(std::memory_order_relaxed);
+			if (tail - head_.load(std::memory_order_acquire) > mask_) {
+				return false;
+			}
+			buffer_[tail & mask_] = std::move(value);
+			tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only called by the producer. Push up to count values, moved from the
+		// array in order, with one update of the shared index. Return the number
+		// of pushed values.
+		size_t push(T* values, size_t count) {
+			size_t tail = tail_.load(std::memory_order_relaxed);
+			size_t space = mask_ + 1 - (tail - head_.load(std::memory_order_acquire));
+			if (count > space) {
+				count = space;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				buffer_[(tail + i) & mask_] = std::move(values[i]);
+			}
+			tail_.store(tail + count, std::memory_order_release);
+			return count;
+		}
+
+		bool push(const T& value) {
+			T copy(value);
+			return push(std::move(copy));
+		}
+
+		// Only called by the consumer. Return false if the queue is empty.
+		bool pop(T& value) {
+			size_t head = head_.load(std::memory_order_relaxed);
+			if (head == tail_.load(std::memory_order_acquire)) {
+				return false;
+			}
+			value = std::move(buffer_[head & mask_]);
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only called by the consumer. Call function(T&) for all values in the queue,
+		// oldest first, and remove them with one update of the shared index.
+		// The function must not pop from the queue. Return the number of values.
+		template <class Function>
+		size_t popAll(Function function) {
+			size_t head = head_.load(std::memory_order_relaxed);
+			size_t tail = tail_.load(std::memory_order_acquire);
+			for (size_t index = head; index != tail; ++index) {
+				function(buffer_[index & mask_]);
+			}
+			head_.store(tail, std::memory_order_release);
+			return tail - head;
+		}
+
+		// Only called by the consumer. Return the oldest value, the queue must not be empty.
+		T& front() {
+			return buffer_[head_.load(std::memory_order_relaxed) & mask_];
+		}
+
+		// Only called by the consumer. Remove the oldest value, the queue must not be empty.
+		void pop() {
+			head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		bool empty() const {
+			return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+		}
+
+		size_t size() const {
+			return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+		}
+
+		size_t capacity() const {
+			return mask_ + 1;
+		}
+
+		// Remove all values. Must only be called when neither the producer
+		// nor the consumer is using the queue.
+		void clear() {
+			T value;
+			while (pop(value)) {
+			}
+		}
+
+	private:
+		std::vector<T> buffer_;
+		size_t mask_;
+
+		// The indexes are padded to be on cache lines of their own, to not let the
+		// producer and consumer share one. Padding instead of alignas, in order for
+		// the queue to be allocated by new without over-aligned allocation.
+		static const size_t CACHE_LINE_SIZE = 64;
+
+		char padding0_[CACHE_LINE_SIZE];
+		std::atomic<size_t> head_; // Next value to pop, written by the consumer.
+		char padding1_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+		std::atomic<size_t> tail_; // Next slot to push, written by the producer.
+		char padding2_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+	};
+
+} // Namespace mw.
+
+#endif // MW_SPSCQUEUE_H